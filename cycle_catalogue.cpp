@@ -0,0 +1,180 @@
+#include "cycle_catalogue.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+
+// (the last digit goes up when the hashes change, see f2poly.h)
+static const char cycle_catalogue_magic[ 8 ] = { 'F', '2', 'C', 'Y', 'C', 'L', 'E', '2' };
+
+
+// bytes before the first record
+static size_t cycle_catalogue_index_size( uint32_t nparams, uint64_t bloom_bits )
+{
+	return sizeof( cycle_catalogue_header_t ) + nparams * sizeof( uint64_t ) + bloom_bits / 8;
+}
+
+
+cycle_catalogue_t::~cycle_catalogue_t( )
+{
+	if( map )
+		munmap( map, map_size );
+	if( fd >= 0 )
+		close( fd );
+}
+
+
+// write the header, params and an empty filter to the (empty, locked) file
+bool cycle_catalogue_t::create( const std::vector< uint64_t > &params )
+{
+	cycle_catalogue_header_t h;
+	memcpy( h.magic, cycle_catalogue_magic, sizeof( h.magic ) );
+	h.bloom_bits = CYCLE_CATALOGUE_BLOOM_BITS;
+	h.nparams = params.size( );
+	h.max_lambda = 0;
+
+	size_t size = cycle_catalogue_index_size( h.nparams, h.bloom_bits );
+
+	if( pwrite( fd, &h, sizeof( h ), 0 ) != sizeof( h )
+	|| pwrite( fd, params.data( ), params.size( ) * sizeof( uint64_t ), sizeof( h ) ) != (ssize_t) ( params.size( ) * sizeof( uint64_t ) )
+	|| ftruncate( fd, size ) )
+		return false;
+
+	return true;
+}
+
+
+bool cycle_catalogue_t::open( const char *path, const std::vector< uint64_t > &params )
+{
+	fd = ::open( path, O_RDWR | O_CREAT, 0644 );
+	if( fd < 0 )
+	{
+		printf( "Error: can't open cycle catalogue %s.\n", path );
+		return false;
+	}
+
+	// a new file gets its index while no one else can look at it
+	flock( fd, LOCK_EX );
+	struct stat st;
+	bool ok = !fstat( fd, &st ) && ( st.st_size || create( params ) );
+	flock( fd, LOCK_UN );
+
+	cycle_catalogue_header_t h;
+	if( !ok || pread( fd, &h, sizeof( h ), 0 ) != sizeof( h )
+	|| memcmp( h.magic, cycle_catalogue_magic, sizeof( h.magic ) )
+	|| !h.bloom_bits || ( h.bloom_bits & ( h.bloom_bits - 1 ) ) || h.bloom_bits < 64 )
+	{
+		printf( "Error: %s is not a cycle catalogue.\n", path );
+		return false;
+	}
+
+	map_size = cycle_catalogue_index_size( h.nparams, h.bloom_bits );
+	map = mmap( NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	if( map == MAP_FAILED )
+	{
+		map = NULL;
+		printf( "Error: can't map cycle catalogue %s.\n", path );
+		return false;
+	}
+
+	header = (cycle_catalogue_header_t *) map;
+	uint64_t *p = (uint64_t *) ( header + 1 );
+	bloom = p + header->nparams;
+	bloom_mask = header->bloom_bits - 1;
+
+	if( header->nparams != params.size( ) || memcmp( p, params.data( ), params.size( ) * sizeof( uint64_t ) ) )
+	{
+		printf( "Error: cycle catalogue %s is for a different map.\n", path );
+		return false;
+	}
+
+	end = map_size;
+	flock( fd, LOCK_SH );
+	read_records( );
+	flock( fd, LOCK_UN );
+
+	return true;
+}
+
+
+// read the records from end to the end of the file (with the file locked)
+void cycle_catalogue_t::read_records( )
+{
+	uint32_t r[ 2 ];
+	std::vector< uint64_t > key;
+
+	while( pread( fd, r, sizeof( r ), end ) == sizeof( r ) )
+	{
+		key.resize( r[ 1 ] );
+		ssize_t bytes = r[ 1 ] * sizeof( uint64_t );
+		if( pread( fd, key.data( ), bytes, end + sizeof( r ) ) != bytes )
+			break;
+
+		keys.insert( key );
+		end += sizeof( r ) + bytes;
+	}
+}
+
+
+bool cycle_catalogue_t::add( const std::vector< uint64_t > &key, unsigned int lambda, const std::vector< uint64_t > &hashes )
+{
+	if( keys.count( key ) )
+		return false;
+
+	// (another run may have added it since we last looked)
+	flock( fd, LOCK_EX );
+	read_records( );
+
+	bool is_new = !keys.count( key );
+	if( is_new )
+	{
+		// the filter first, so the cycle is never listed without it
+		for( unsigned int k = 0; k < hashes.size( ); k++ )
+			for( unsigned int j = 0; j < CYCLE_CATALOGUE_PROBES; j++ )
+			{
+				uint64_t b = probe( hashes[ k ], j );
+				__atomic_fetch_or( &bloom[ b / 64 ], uint64_t( 1 ) << ( b % 64 ), __ATOMIC_RELAXED );
+			}
+
+		if( lambda > header->max_lambda )
+			header->max_lambda = lambda;
+
+		// the whole record in one write
+		uint32_t r[ 2 ] = { lambda, (uint32_t) key.size( ) };
+		std::vector< char > record( sizeof( r ) + key.size( ) * sizeof( uint64_t ) );
+		memcpy( record.data( ), r, sizeof( r ) );
+		memcpy( record.data( ) + sizeof( r ), key.data( ), key.size( ) * sizeof( uint64_t ) );
+
+		if( pwrite( fd, record.data( ), record.size( ), end ) == (ssize_t) record.size( ) )
+		{
+			keys.insert( key );
+			end += record.size( );
+			added++;
+		}
+		else
+			is_new = false;
+	}
+
+	flock( fd, LOCK_UN );
+	return is_new;
+}
+
+
+bool cycle_catalogue_t::key_less( const std::vector< uint64_t > &a, const std::vector< uint64_t > &b )
+{
+	if( a.size( ) != b.size( ) )
+		return a.size( ) < b.size( );
+
+	for( size_t k = a.size( ); k > 0; k-- )
+		if( a[ k - 1 ] != b[ k - 1 ] )
+			return a[ k - 1 ] < b[ k - 1 ];
+
+	return false;
+}
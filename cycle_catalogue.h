@@ -0,0 +1,103 @@
+/* cycle_catalogue_t
+ *
+ * A catalogue of the cycles found so far for one mx+1 map, kept in a file
+ * so that later runs (and runs going on at the same time) can use it.
+ * Each cycle is stored under its smallest term (see key_less), as a list
+ * of words whose meaning is up to the caller, together with its length.
+ * A Bloom filter over the hashes of all the terms of all the cycles lets
+ * the cycle search check cheaply, at every step, whether it may have
+ * entered one of them.
+ *
+ * The file starts with a header, the words identifying the map, and the
+ * filter; these are mapped into memory, shared, so bits set by one run
+ * show up in the others. After them come the cycles, one record each:
+ *     lambda, number of words in the key (32 bits each), the key
+ * Records are only ever appended, under an exclusive lock on the file.
+ *
+ */
+
+
+#ifndef CYCLE_CATALOGUE_H
+#define CYCLE_CATALOGUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <set>
+#include <vector>
+
+
+// size of the Bloom filter in a new catalogue (bits, a power of 2), and
+// the number of bits each hash sets in it
+#define CYCLE_CATALOGUE_BLOOM_BITS ( uint64_t( 1 ) << 23 )
+#define CYCLE_CATALOGUE_PROBES 4
+
+
+struct cycle_catalogue_header_t
+{
+	char magic[ 8 ];
+	uint64_t bloom_bits;
+	uint32_t nparams;		// words identifying the map
+	uint32_t max_lambda;	// longest cycle in the catalogue
+};
+
+
+class cycle_catalogue_t
+{
+	private:
+		int fd;
+		void *map;
+		size_t map_size;
+
+		cycle_catalogue_header_t *header;
+		uint64_t *bloom;
+		uint64_t bloom_mask;
+
+		std::set< std::vector< uint64_t > > keys;	// of the cycles read so far
+		uint64_t end;								// where reading stopped
+
+		bool create( const std::vector< uint64_t > &params );
+		void read_records( );
+
+		// the j-th bit of the filter for hash h
+		uint64_t probe( uint64_t h, unsigned int j ) const { return ( h + j * ( ( h >> 32 ) | 1 ) * 0x9e3779b97f4a7c15 ) & bloom_mask; }
+
+	public:
+		unsigned int hits;		// trajectories stopped on entering a cycle
+		unsigned int added;		// cycles this run added
+
+		cycle_catalogue_t( ) : fd( -1 ), map( NULL ), map_size( 0 ), header( NULL ), bloom( NULL ), bloom_mask( 0 ), end( 0 ), hits( 0 ), added( 0 ) { }
+		~cycle_catalogue_t( );
+
+		// open the catalogue at path for the map identified by params,
+		// making a new one if there isn't one. Returns false (with a
+		// message) if it can't, or if the file is for a different map.
+		bool open( const char *path, const std::vector< uint64_t > &params );
+
+		size_t size( ) const { return keys.size( ); }
+		unsigned int max_lambda( ) const { return header->max_lambda; }
+
+		// false if no term of any cycle in the catalogue has hash h
+		bool may_contain( uint64_t h ) const
+		{
+			for( unsigned int j = 0; j < CYCLE_CATALOGUE_PROBES; j++ )
+			{
+				uint64_t b = probe( h, j );
+				if( !( bloom[ b / 64 ] >> ( b % 64 ) & 1 ) )
+					return false;
+			}
+			return true;
+		}
+
+		// add the cycle with smallest term key, length lambda, and the
+		// given hashes of its terms, unless it's already there. Returns
+		// whether it was new.
+		bool add( const std::vector< uint64_t > &key, unsigned int lambda, const std::vector< uint64_t > &hashes );
+
+		// the order which picks the key of a cycle: fewer words first,
+		// then by the words from the top down
+		static bool key_less( const std::vector< uint64_t > &a, const std::vector< uint64_t > &b );
+};
+
+
+
+#endif
@@ -0,0 +1,126 @@
+/* cycle_detector
+ *
+ * The cycle detection algorithms f2t_findperiod and f2xt_findperiod can
+ * use, picked by name in the drivers:
+ *
+ *   brent: Brent's algorithm finds lambda, then the trajectory is run again
+ *       from the start, with a second pointer lambda steps ahead, to find mu
+ *   nivasch: Nivasch's stack algorithm, with the terms partitioned into
+ *       NIVASCH_STACKS classes, finds lambda in a single pass, usually a
+ *       little over mu + lambda steps in. It is a lambda detector: mu
+ *       still takes a bounded search afterwards. Going round the cycle once
+ *       more shows which terms on the stacks come before the cycle, and
+ *       the search for mu starts from the latest of them (typically about
+ *       lambda / NIVASCH_STACKS steps before mu) rather than from f, so
+ *       after lambda is found it costs about 2 lambda more steps.
+ *
+ * Every term goes on a stack, so nivasch takes single steps: it ignores
+ * the jumps and the options which only apply to Brent's algorithm
+ * (distinguished points, the catalogue, the visited marks and so on), and
+ * the drivers warn if any of them are set (cycle_detector_ignored).
+ *
+ * Both give the same sigma, mu and lambda for the cycles they report, and
+ * nivasch reports a cycle only if Brent's algorithm would have seen it
+ * before the timeout too (brent_detection_step). It can still time out
+ * where Brent's algorithm doesn't, when the stacks see the cycle later
+ * than Brent's tortoise does.
+ *
+ */
+
+
+#ifndef CYCLE_DETECTOR_H
+#define CYCLE_DETECTOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// largest number of terms on each of Nivasch's stacks. One holds
+// O(log n) terms after n steps on average; if it does fill up, the bottom
+// term is dropped, which can only delay finding the cycle.
+#define NIVASCH_STACK_MAX 1024
+
+
+// Nivasch's algorithm splits the terms into 2^NIVASCH_STACK_BITS classes
+// by hash, each with its own stack. The cycle is found once the smallest
+// term of any class in it comes round again, so with more classes that
+// happens sooner after mu + lambda, and the stacks together pin mu down
+// more closely.
+#define NIVASCH_STACK_BITS 4
+#define NIVASCH_STACKS ( 1 << NIVASCH_STACK_BITS )
+
+
+// the class of a term with this hash. The hash of a term of degree < 64
+// is the polynomial itself, so its top bits are mixed in with a
+// multiplication first.
+inline unsigned int nivasch_class( uint64_t hash )
+{
+	return ( hash * 0x9e3779b97f4a7c15ULL ) >> ( 64 - NIVASCH_STACK_BITS );
+}
+
+
+// largest number of tortoise positions Brent's algorithm keeps for the mu
+// search. They are taken at powers of 2, so this many cover any timeout;
+// if there are more, the earliest are dropped.
+#define BRENT_CHECKPOINTS_MAX 32
+
+
+enum cycle_detector_t { DETECT_BRENT, DETECT_NIVASCH };
+
+
+// look up a detector by name; NULL means the default (Brent). Returns
+// false for an unknown name.
+inline bool cycle_detector_parse( const char *name, cycle_detector_t *detector )
+{
+	if( name == NULL || !strcmp( name, "brent" ) )
+		*detector = DETECT_BRENT;
+	else if( !strcmp( name, "nivasch" ) )
+		*detector = DETECT_NIVASCH;
+	else
+		return false;
+	
+	return true;
+}
+
+
+inline const char *cycle_detector_name( cycle_detector_t detector )
+{
+	return detector == DETECT_NIVASCH ? "nivasch" : "brent";
+}
+
+
+// warn about the environment variables in the NULL-terminated list names
+// which are set but which detector ignores
+inline void cycle_detector_ignored( cycle_detector_t detector, const char *const *names )
+{
+	if( detector == DETECT_BRENT )
+		return;
+	
+	for( ; *names; names++ )
+		if( getenv( *names ) )
+			printf( "Warning: cycle detector %s ignores %s.\n", cycle_detector_name( detector ), *names );
+}
+
+
+
+// the hare's step when Brent's algorithm (f2t_brent, f2xt_brent) sees a
+// cycle with these mu and lambda: the tortoise sits at 2^j - 1 while the
+// hare goes through the next 2^j terms
+inline uint64_t brent_detection_step( unsigned int mu, unsigned int lambda )
+{
+	uint64_t tortoise = 0, i = 1;
+	while( tortoise < mu || i < lambda )
+	{
+		tortoise += i;
+		i <<= 1;
+	}
+
+	return tortoise + lambda;
+}
+
+
+
+
+#endif
@@ -0,0 +1,189 @@
+/* distinguished_points_t
+ *
+ * Distinguished points shared by the trajectories in a block. Terms whose
+ * hash has its lowest bits all 0 are distinguished. Each one that a
+ * trajectory lands on is kept, along with its step, and once the
+ * trajectory's outcome is known, they go into a table with that outcome.
+ * When a later trajectory lands on a point in the table, the rest of its
+ * trajectory is the same as the earlier one's from there, so it can stop
+ * and work out its own sigma, mu and lambda by shifting the earlier ones.
+ *
+ * Points are looked up by hash, the fingerprint (see f2poly.h), and each
+ * keeps its words as well, so a hit is only taken once they match: two
+ * terms with the same fingerprint can't pass on the wrong outcome.
+ *
+ * Only what Brent's algorithm would have given is inherited: a trajectory
+ * that would time out, or whose sigma can't be known from the point,
+ * carries on by itself.
+ *
+ * The threads of a block share one table: each has its own copy of the
+ * distinguished_points_t for its current trajectory, and the table is
+ * split by hash into shards with a lock each.
+ *
+ */
+
+
+#ifndef DISTINGUISHED_POINTS_H
+#define DISTINGUISHED_POINTS_H
+
+#include "cycle_detector.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+// largest number of points in the table; after that, no more are added
+#define DISTINGUISHED_POINTS_MAX ( 1u << 24 )
+
+// number of shards the table is split into (by the hash bits just above the
+// zero ones)
+#define DISTINGUISHED_POINTS_SHARDS 64
+
+
+class distinguished_points_t
+{
+	public:
+		struct entry_t
+		{
+			unsigned int step;					// of the point
+			unsigned int deg0, mu, lambda, sigma;	// of its trajectory
+		};
+
+	private:
+		struct point_t
+		{
+			std::vector< uint64_t > key;		// the words of the point
+			entry_t e;
+		};
+		
+		struct shard_t
+		{
+			std::mutex lock;
+			std::unordered_map< uint64_t, point_t > points;
+		};
+		
+		struct table_t
+		{
+			shard_t shards[ DISTINGUISHED_POINTS_SHARDS ];
+			std::atomic< size_t > size;
+			
+			table_t( ) : size( 0 ) { }
+		};
+		
+		unsigned int bits;
+		uint64_t mask;
+		std::shared_ptr< table_t > table;
+		std::vector< std::pair< uint64_t, point_t > > pending;	// current trajectory
+		
+		shard_t &shard( uint64_t hash ) const { return table->shards[ ( hash >> bits ) % DISTINGUISHED_POINTS_SHARDS ]; }
+
+	public:
+		unsigned int merged;	// number of trajectories which stopped at a point
+
+		distinguished_points_t( unsigned int bits ) : bits( bits ), mask( ( uint64_t( 1 ) << bits ) - 1 ), table( new table_t ), merged( 0 ) { }
+		
+		// another thread's view of the same table, with its own current
+		// trajectory and count of merges
+		distinguished_points_t( const distinguished_points_t &other )
+			: bits( other.bits ), mask( other.mask ), table( other.table ), merged( 0 ) { }
+
+		bool is_distinguished( uint64_t hash ) const { return !( hash & mask ); }
+		size_t size( ) const { return table->size; }
+
+		// the entry for the point with this hash and these words, or NULL.
+		// (Entries are never changed or removed once they are in the table,
+		// so it stays valid.)
+		const entry_t *find( uint64_t hash, const std::vector< uint64_t > &key ) const
+		{
+			shard_t &s = shard( hash );
+			std::lock_guard< std::mutex > guard( s.lock );
+			
+			std::unordered_map< uint64_t, point_t >::const_iterator it = s.points.find( hash );
+			return it != s.points.end( ) && it->second.key == key ? &it->second.e : NULL;
+		}
+
+		// the current trajectory has reached a point
+		void add( uint64_t hash, const std::vector< uint64_t > &key, unsigned int step )
+		{
+			point_t p = { key, { step, 0, 0, 0, 0 } };
+			pending.push_back( std::make_pair( hash, p ) );
+		}
+
+		// the current trajectory is done; its points go in the table unless
+		// it timed out
+		void finish( unsigned int deg0, bool resolved, unsigned int mu, unsigned int lambda, unsigned int sigma )
+		{
+			for( unsigned int k = 0; resolved && k < pending.size( ) && table->size < DISTINGUISHED_POINTS_MAX; k++ )
+			{
+				entry_t &e = pending[ k ].second.e;
+				e.deg0 = deg0;
+				e.mu = mu;
+				e.lambda = lambda;
+				e.sigma = sigma;
+				
+				shard_t &s = shard( pending[ k ].first );
+				std::lock_guard< std::mutex > guard( s.lock );
+				if( s.points.insert( std::move( pending[ k ] ) ).second )
+					table->size++;
+			}
+
+			pending.clear( );
+		}
+
+		// A trajectory starting at degree deg0 is at e's point after step
+		// steps, with sigma found so far. Returns false if it has to carry
+		// on by itself; otherwise sets sigma, mu and lambda. If the point is
+		// already in the cycle, mu is left 0 for the caller to find.
+		bool inherit( const entry_t &e, unsigned int step, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+		{
+			if( !shift( e, step, deg0, timeout, mu, lambda, sigma ) )
+				return false;
+
+			merged++;
+			return true;
+		}
+
+		// the same, without counting it (also used by f2t_visited_t)
+		static bool shift( const entry_t &e, unsigned int step, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+		{
+			// the first term below deg0 after the point, if the earlier
+			// trajectory hadn't already gone below it
+			unsigned int s = *sigma;
+			if( !s )
+			{
+				if( e.deg0 != deg0 || ( e.sigma && e.sigma <= e.step ) )
+					return false;
+				if( e.sigma )
+					s = step + e.sigma - e.step;
+			}
+
+			unsigned int m = 0;
+			if( !e.lambda )
+			{
+				// reaches 1 (or 0); at the timeout itself that still counts
+				m = step + e.mu - e.step;
+				if( m > timeout )
+					return false;
+			}
+			else if( e.step < e.mu )
+			{
+				m = step + e.mu - e.step;
+				if( brent_detection_step( m, e.lambda ) >= timeout )
+					return false;
+			}
+			else if( brent_detection_step( step, e.lambda ) >= timeout )
+				return false;	// mu <= step, which may or may not be soon enough
+
+			*sigma = s;
+			*mu = m;
+			*lambda = e.lambda;
+			return true;
+		}
+};
+
+
+
+#endif
@@ -1,8 +1,17 @@
 #include "f2poly.h"
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
 #include <vector>
 
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
 // masks for each bit in word
 const uint64_t bits[ 64 ] = { 1,2,4,8,16,32,64,128,256,512,1024,
 2048,4096,8192,16384,32768,65536,131072,262144,524288,1048576,2097152,
@@ -19,23 +28,680 @@ const uint64_t bits[ 64 ] = { 1,2,4,8,16,32,64,128,256,512,1024,
 
 
 
-// ceil(log_2(x)) (used to find most significant nonzero bit)
+// floor(log_2(x)) (used to find most significant nonzero bit)
 unsigned int ilog2( uint64_t x )
 {
-	if( !x || x == 1 ) return 0;
+	return topbit( x );
+}
+
+
+
+/**********************************************************************/
+/************************** WORD STORAGE ******************************/
+/**********************************************************************/
+// Size class c holds arrays of 2^c words. A free array keeps the link to
+// the next one in its first word. The lists belong to the thread which
+// freed the arrays, whichever thread allocated them, and go back to the
+// system allocator when it exits; anything freed on the thread after that
+// goes straight back too.
+
+
+struct pool_t
+{
+	void *free_list[ 64 ];
+	bool closed;
+	
+	~pool_t( )
+	{
+		for( unsigned int c = 0; c < 64; c++ )
+			while( free_list[ c ] != NULL )
+			{
+				void *p = free_list[ c ];
+				free_list[ c ] = *static_cast< void** >( p );
+				::operator delete( p );
+			}
+		
+		closed = true;
+	}
+};
+
+
+static thread_local pool_t pool = { { NULL }, false };
+
+
+static inline unsigned int pool_size_class( std::size_t n )
+{
+	return n <= 1 ? 0 : WORDLENGTH - __builtin_clzll( n - 1 );
+}
+
+
+void *f2poly_pool_alloc( std::size_t n )
+{
+	unsigned int c = pool_size_class( n );
+	void *p = pool.free_list[ c ];
+	
+	if( p == NULL )
+		return ::operator new( sizeof( uint64_t ) << c );
+	
+	pool.free_list[ c ] = *static_cast< void** >( p );
+	return p;
+}
+
+
+void f2poly_pool_free( void *p, std::size_t n )
+{
+	if( pool.closed )
+	{
+		::operator delete( p );
+		return;
+	}
+	
+	unsigned int c = pool_size_class( n );
+	
+	*static_cast< void** >( p ) = pool.free_list[ c ];
+	pool.free_list[ c ] = p;
+}
+
+
+
+/**********************************************************************/
+/************************* MULTIPLY KERNELS ***************************/
+/**********************************************************************/
+// Each kernel multiplies the l words at w by m (deg m < 64) in place and
+// returns the word carried out of the top. One of them is picked when the
+// program starts, depending on what the CPU supports.
+
+
+// portable version: xor in a shifted copy of f for each 1 bit of m
+static uint64_t mulkernel_bitloop( uint64_t *w, unsigned int l, uint64_t m )
+{
+	unsigned int md = ilog2( m );
+	
+	uint64_t prev = 0;	// original value of the word below
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		uint64_t new_word = 0;
+		
+		// for each index i such that m_i == 1
+		for( unsigned int i = 0; i <= md; i++ )
+			if( m & bits[ i ] )
+			{
+				new_word ^= ( w[ k ] << i );	// xor with itself shifted left
+				if( i )							// and with top bits from the word below
+					new_word ^= ( prev >> ( WORDLENGTH - i ) );
+			}
+		
+		prev = w[ k ];
+		w[ k ] = new_word;
+	}
+	
+	// top bits of the last word
+	uint64_t carryover = 0;
+	for( unsigned int i = 1; i <= md; i++ )
+		if( m & bits[ i ] )
+			carryover ^= ( prev >> ( WORDLENGTH - i ) );
+	
+	return carryover;
+}
+
+
+#if defined( __x86_64__ )
+
+// carry-less multiply, one 64x64 -> 128 bit product per word
+__attribute__(( target( "pclmul" ) ))
+static uint64_t mulkernel_pclmul( uint64_t *w, unsigned int l, uint64_t m )
+{
+	__m128i mm = _mm_cvtsi64_si128( m );
+	uint64_t carryover = 0;
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( w[ k ] ), mm, 0x00 );
+		
+		w[ k ] = _mm_cvtsi128_si64( p ) ^ carryover;				// low half
+		carryover = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );	// high half
+	}
+	
+	return carryover;
+}
+
+
+// single word product, for f2poly_mulword_clmul_t
+__attribute__(( target( "pclmul" ) ))
+uint64_t f2poly_clmulword( uint64_t a, uint64_t m, uint64_t *hi )
+{
+	__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( a ), _mm_cvtsi64_si128( m ), 0x00 );
+	
+	*hi = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );
+	return _mm_cvtsi128_si64( p );
+}
+
+
+// lo + t^64 hi mod P for the fingerprints, by Barrett's method (see
+// f2poly_gfreduce)
+__attribute__(( target( "pclmul" ) ))
+static inline uint64_t gfreduce_pclmul( uint64_t lo, uint64_t hi )
+{
+	__m128i q = _mm_clmulepi64_si128( _mm_cvtsi64_si128( hi ), _mm_cvtsi64_si128( FINGERPRINT_MU ), 0x00 );
+	uint64_t quotient = hi ^ _mm_cvtsi128_si64( _mm_unpackhi_epi64( q, q ) );
+	
+	__m128i r = _mm_clmulepi64_si128( _mm_cvtsi64_si128( quotient ), _mm_cvtsi64_si128( FINGERPRINT_POLY ), 0x00 );
+	return lo ^ _mm_cvtsi128_si64( r );
+}
+
+
+// AVX-512 carry-less multiply, eight words at a time. Even and odd words
+// are multiplied separately; the products of the even words land exactly
+// on their own two words, and the products of the odd words have to be
+// moved up by one word (across 128 bit lanes) before adding.
+__attribute__(( target( "avx512f,vpclmulqdq,pclmul" ) ))
+static uint64_t mulkernel_vpclmul( uint64_t *w, unsigned int l, uint64_t m )
+{
+	__m512i mm = _mm512_set1_epi64( m );
+	__m512i odd_prev = _mm512_setzero_si512( );
+	
+	unsigned int k = 0;
+	for( ; k + 8 <= l; k += 8 )
+	{
+		__m512i v = _mm512_loadu_si512( w + k );
+		__m512i even = _mm512_clmulepi64_epi128( v, mm, 0x00 );
+		__m512i odd = _mm512_clmulepi64_epi128( v, mm, 0x01 );
+		
+		// odd products shifted up one word, bringing in the top word of the
+		// previous block
+		__m512i shifted = _mm512_maskz_alignr_epi64( 0xff, odd, odd_prev, 7 );
+		
+		_mm512_storeu_si512( w + k, _mm512_xor_si512( even, shifted ) );
+		odd_prev = odd;
+	}
+	
+	uint64_t top[ 8 ];
+	_mm512_storeu_si512( top, odd_prev );
+	uint64_t carryover = top[ 7 ];
+	
+	// finish the remaining (< 8) words one at a time
+	__m128i m1 = _mm_cvtsi64_si128( m );
+	for( ; k < l; k++ )
+	{
+		__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( w[ k ] ), m1, 0x00 );
+		
+		w[ k ] = _mm_cvtsi128_si64( p ) ^ carryover;
+		carryover = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );
+	}
+	
+	return carryover;
+}
+
+#endif
+
+
+
+// Accumulating kernels, used for products of two polynomials: add a*m to
+// r, where a has l words (so l + 1 words of r change).
+typedef void (*f2poly_addmulkernel_t)( uint64_t *r, const uint64_t *a, unsigned int l, uint64_t m );
+
+
+static void addmulkernel_bitloop( uint64_t *r, const uint64_t *a, unsigned int l, uint64_t m )
+{
+	uint64_t carryover = 0;
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		uint64_t hi;
+		r[ k ] ^= mulword( a[ k ], m, &hi ) ^ carryover;
+		carryover = hi;
+	}
+	
+	r[ l ] ^= carryover;
+}
+
+
+#if defined( __x86_64__ )
+
+__attribute__(( target( "pclmul" ) ))
+static void addmulkernel_pclmul( uint64_t *r, const uint64_t *a, unsigned int l, uint64_t m )
+{
+	__m128i mm = _mm_cvtsi64_si128( m );
+	uint64_t carryover = 0;
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( a[ k ] ), mm, 0x00 );
+		
+		r[ k ] ^= _mm_cvtsi128_si64( p ) ^ carryover;
+		carryover = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );
+	}
+	
+	r[ l ] ^= carryover;
+}
+
+
+// eight words at a time, as in mulkernel_vpclmul
+__attribute__(( target( "avx512f,vpclmulqdq,pclmul" ) ))
+static void addmulkernel_vpclmul( uint64_t *r, const uint64_t *a, unsigned int l, uint64_t m )
+{
+	__m512i mm = _mm512_set1_epi64( m );
+	__m512i odd_prev = _mm512_setzero_si512( );
+	
+	unsigned int k = 0;
+	for( ; k + 8 <= l; k += 8 )
+	{
+		__m512i v = _mm512_loadu_si512( a + k );
+		__m512i even = _mm512_clmulepi64_epi128( v, mm, 0x00 );
+		__m512i odd = _mm512_clmulepi64_epi128( v, mm, 0x01 );
+		__m512i shifted = _mm512_maskz_alignr_epi64( 0xff, odd, odd_prev, 7 );
+		
+		__m512i rk = _mm512_loadu_si512( r + k );
+		_mm512_storeu_si512( r + k, _mm512_xor_si512( rk, _mm512_xor_si512( even, shifted ) ) );
+		odd_prev = odd;
+	}
+	
+	uint64_t top[ 8 ];
+	_mm512_storeu_si512( top, odd_prev );
+	uint64_t carryover = top[ 7 ];
+	
+	__m128i m1 = _mm_cvtsi64_si128( m );
+	for( ; k < l; k++ )
+	{
+		__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( a[ k ] ), m1, 0x00 );
+		
+		r[ k ] ^= _mm_cvtsi128_si64( p ) ^ carryover;
+		carryover = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );
+	}
+	
+	r[ l ] ^= carryover;
+}
+
+#endif
+
+
+static f2poly_addmulkernel_t addmulkernel = addmulkernel_bitloop;
+
+
+
+// Fused kernels for ( f*m + 1 ) / t. They read f from the bit array w
+// (size words) starting at bit offset, and write the l words of the result
+// to the bottom of w. Word k of the result only depends on words k and
+// k + 1 of the product, so it can be written as soon as word k + 1 of f
+// has been read: the array is read ahead of where it is written. They
+// also return the fingerprint fp times m, reduced (see f2poly.h), which
+// saves a call per step.
+typedef uint64_t (*f2poly_mx1kernel_t)( uint64_t *w, unsigned int size, unsigned int offset, unsigned int l, uint64_t m, uint64_t fp );
+
+
+// word k of f, where f starts at bit offset of w
+static inline uint64_t offset_word( const uint64_t *w, unsigned int size, unsigned int offset, unsigned int k )
+{
+	unsigned int j = k + offset / WORDLENGTH;
+	unsigned int shift = offset % WORDLENGTH;
+	
+	uint64_t a = j < size ? w[ j ] >> shift : 0;
+	if( shift && j + 1 < size )
+		a |= w[ j + 1 ] << ( WORDLENGTH - shift );
+	return a;
+}
+
+
+static uint64_t mx1kernel_bitloop( uint64_t *w, unsigned int size, unsigned int offset, unsigned int l, uint64_t m, uint64_t fp )
+{
+	uint64_t hi;
+	uint64_t p = mulword( offset_word( w, size, offset, 0 ), m, &hi ) ^ 1;	// word 0 of f*m + 1
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		uint64_t carryover = hi;
+		uint64_t p_next = mulword( offset_word( w, size, offset, k + 1 ), m, &hi ) ^ carryover;
+		
+		w[ k ] = ( p >> 1 ) | ( p_next << ( WORDLENGTH - 1 ) );
+		p = p_next;
+	}
+	
+	uint64_t fp_lo = mulword( fp, m, &hi );
+	return f2poly_gfreduce( fp_lo, hi );
+}
+
+
+#if defined( __x86_64__ )
+
+__attribute__(( target( "pclmul" ) ))
+static uint64_t mx1kernel_pclmul( uint64_t *w, unsigned int size, unsigned int offset, unsigned int l, uint64_t m, uint64_t fp )
+{
+	__m128i mm = _mm_cvtsi64_si128( m );
+	
+	__m128i prod = _mm_clmulepi64_si128( _mm_cvtsi64_si128( offset_word( w, size, offset, 0 ) ), mm, 0x00 );
+	uint64_t p = _mm_cvtsi128_si64( prod ) ^ 1;
+	uint64_t hi = _mm_cvtsi128_si64( _mm_unpackhi_epi64( prod, prod ) );
+	
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		prod = _mm_clmulepi64_si128( _mm_cvtsi64_si128( offset_word( w, size, offset, k + 1 ) ), mm, 0x00 );
+		uint64_t p_next = _mm_cvtsi128_si64( prod ) ^ hi;
+		hi = _mm_cvtsi128_si64( _mm_unpackhi_epi64( prod, prod ) );
+		
+		w[ k ] = ( p >> 1 ) | ( p_next << ( WORDLENGTH - 1 ) );
+		p = p_next;
+	}
+	
+	prod = _mm_clmulepi64_si128( _mm_cvtsi64_si128( fp ), mm, 0x00 );
+	return gfreduce_pclmul( _mm_cvtsi128_si64( prod ), _mm_cvtsi128_si64( _mm_unpackhi_epi64( prod, prod ) ) );
+}
+
+#endif
+
+
+static f2poly_mx1kernel_t mx1kernel = mx1kernel_bitloop;
+
+
+// pick the fastest kernel the CPU supports. Setting the environment
+// variable F2POLY_KERNEL to "bitloop", "pclmul" or "vpclmul" overrides
+// the choice (unsupported choices fall back to the bit loop).
+static const char *mulkernel_name = "bitloop";
+static bool clmul_available = false;
+
+static f2poly_mulkernel_t select_mulkernel( )
+{
+	const char *want = getenv( "F2POLY_KERNEL" );
+	
+#if defined( __x86_64__ )
+	__builtin_cpu_init( );
+	bool has_pclmul = __builtin_cpu_supports( "pclmul" );
+	bool has_vpclmul = has_pclmul && __builtin_cpu_supports( "avx512f" )
+		&& __builtin_cpu_supports( "vpclmulqdq" );
+	
+	if( want != NULL && !strcmp( want, "bitloop" ) )
+		has_pclmul = has_vpclmul = false;
+	else if( want != NULL && !strcmp( want, "pclmul" ) )
+		has_vpclmul = false;
+	
+	// (the fused kernel has no AVX-512 version; it reads f at a bit offset)
+	if( has_pclmul )
+	{
+		mx1kernel = mx1kernel_pclmul;
+		clmul_available = true;
+	}
+	
+	if( has_vpclmul )
+	{
+		mulkernel_name = "vpclmul";
+		addmulkernel = addmulkernel_vpclmul;
+		return mulkernel_vpclmul;
+	}
+	if( has_pclmul )
+	{
+		mulkernel_name = "pclmul";
+		addmulkernel = addmulkernel_pclmul;
+		return mulkernel_pclmul;
+	}
+#else
+	(void) want;
+#endif
+	
+	mulkernel_name = "bitloop";
+	return mulkernel_bitloop;
+}
+
+f2poly_mulkernel_t mulkernel = select_mulkernel( );
+
+
+const char *f2poly_kernel_name( )
+{
+	return mulkernel_name;
+}
+
+
+bool f2poly_has_clmul( )
+{
+	return clmul_available;
+}
+
+
+#if !defined( __x86_64__ )
+// never called (f2poly_has_clmul( ) is false), but it has to exist
+uint64_t f2poly_clmulword( uint64_t a, uint64_t m, uint64_t *hi )
+{
+	return mulword( a, m, hi );
+}
+#endif
+
+
+
+// the shape of m, and its products with everything of degree < 4
+f2poly_mword_t::f2poly_mword_t( uint64_t a ) : m( a ), terms( __builtin_popcountll( a ) )
+{
+	uint64_t b = a;
+	for( unsigned int i = 0; i < 3; i++ )
+	{
+		shift[ i ] = b ? __builtin_ctzll( b ) : 0;
+		b &= b - 1;
+	}
+	
+	for( unsigned int n = 0; n < 16; n++ )
+		lo[ n ] = mulword( n, a, &hi[ n ] );
+}
+
+
+
+/**********************************************************************/
+/*************************** FINGERPRINTS *****************************/
+/**********************************************************************/
+// arithmetic in GF(2^64) = F_2[t]/(P) for the fingerprints (see f2poly.h)
+
+
+// lo + t^64 hi mod P. With P - t^64 dense, folding hi back in a word at a
+// time would take up to 64 rounds; Barrett's method takes two products
+// instead: the quotient is hi + the high word of hi * MU (MU = t^128 / P -
+// t^64), and the remainder is lo + the low word of quotient * ( P - t^64 ).
+// (The high words of both sides agree, so they needn't be worked out.)
+uint64_t f2poly_gfreduce( uint64_t lo, uint64_t hi )
+{
+#if defined( __x86_64__ )
+	if( clmul_available )
+		return gfreduce_pclmul( lo, hi );
+#endif
+	
+	uint64_t qhi;
+	mulword( hi, FINGERPRINT_MU, &qhi );
+	
+	uint64_t rhi;
+	return lo ^ mulword( hi ^ qhi, FINGERPRINT_POLY, &rhi );
+}
+
+
+#if defined( __x86_64__ )
+
+__attribute__(( target( "pclmul" ) ))
+static uint64_t gfmul_pclmul( uint64_t a, uint64_t b )
+{
+	__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( a ), _mm_cvtsi64_si128( b ), 0x00 );
 	
-	unsigned int l = 1;
-	while( l <= WORDLENGTH && x >> l > 1) l++;
-	return l;
+	return gfreduce_pclmul( _mm_cvtsi128_si64( p ), _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) ) );
 }
 
+#endif
+
+
+// a*b mod P. Without a carry-less multiply this loops over the 1 bits of b,
+// so b should be the sparse one if there is one
+uint64_t f2poly_gfmul( uint64_t a, uint64_t b )
+{
+#if defined( __x86_64__ )
+	if( clmul_available )
+		return gfmul_pclmul( a, b );
+#endif
+	
+	uint64_t hi;
+	uint64_t lo = mulword( a, b, &hi );
+	
+	return f2poly_gfreduce( lo, hi );
+}
+
+
+// Horner's rule, a word at a time: alpha^64 = P - t^64
+uint64_t f2poly_fingerprint( const uint64_t *w, unsigned int l )
+{
+	uint64_t h = 0;
+	for( unsigned int k = l; k > 0; k-- )
+		h = f2poly_gfmul( h, FINGERPRINT_POLY ) ^ w[ k - 1 ];
+	
+	return h;
+}
+
+
+// alpha^(64*2^i) and alpha^(-64*2^i), and alpha^(-k) for k < 64
+static uint64_t alpha_up[ 32 ], alpha_down[ 32 ], alpha_inverse[ WORDLENGTH ];
+
+static bool init_alpha_powers( )
+{
+	alpha_up[ 0 ] = FINGERPRINT_POLY;
+	
+	alpha_inverse[ 0 ] = 1;
+	for( unsigned int k = 1; k < WORDLENGTH; k++ )
+		alpha_inverse[ k ] = f2poly_gfdivalpha( alpha_inverse[ k - 1 ] );
+	alpha_down[ 0 ] = f2poly_gfdivalpha( alpha_inverse[ WORDLENGTH - 1 ] );
+	
+	for( unsigned int i = 1; i < 32; i++ )
+	{
+		alpha_up[ i ] = f2poly_gfmul( alpha_up[ i - 1 ], alpha_up[ i - 1 ] );
+		alpha_down[ i ] = f2poly_gfmul( alpha_down[ i - 1 ], alpha_down[ i - 1 ] );
+	}
+	
+	return true;
+}
+
+static bool alpha_powers_ready = init_alpha_powers( );
+
+
+// alpha^k, or alpha^(-k)
+static uint64_t alpha_power( unsigned int k, bool inverse )
+{
+	(void) alpha_powers_ready;
+	
+	uint64_t h = inverse ? alpha_inverse[ k % WORDLENGTH ] : bits[ k % WORDLENGTH ];
+	const uint64_t *big = inverse ? alpha_down : alpha_up;
+	
+	for( unsigned int i = 0, j = k / WORDLENGTH; j; i++, j >>= 1 )
+		if( j & 1 )
+			h = f2poly_gfmul( h, big[ i ] );
+	
+	return h;
+}
+
+
+void f2poly_t::refingerprint( )
+{
+	fprint = 0;
+	for( unsigned int k = size( ); k > 0; k-- )
+		fprint = f2poly_gfmul( fprint, FINGERPRINT_POLY ) ^ word( k - 1 );
+}
+
+
+
+/**********************************************************************/
+/*********************** POLYNOMIAL PRODUCTS **************************/
+/**********************************************************************/
+// products of two polynomials given as arrays of words. Schoolbook
+// multiplication makes one pass of the accumulating kernel over a for
+// each word of b; above KARATSUBA_THRESHOLD words, Karatsuba's method
+// replaces one of the four half-size products by additions.
+
+
+// below this many words, Karatsuba's method isn't worth it
+#define KARATSUBA_THRESHOLD 24
+
+
+// r[ 0 .. la + lb ) = a * b
+static void mul_schoolbook( uint64_t *r, const uint64_t *a, unsigned int la, const uint64_t *b, unsigned int lb )
+{
+	for( unsigned int k = 0; k < la + lb; k++ )
+		r[ k ] = 0;
+	
+	for( unsigned int j = 0; j < lb; j++ )
+		addmulkernel( r + j, a, la, b[ j ] );
+}
+
+
+// r[ 0 .. 2n ) = a * b, where a and b both have n words
+static void mul_karatsuba( uint64_t *r, const uint64_t *a, const uint64_t *b, unsigned int n )
+{
+	if( n < KARATSUBA_THRESHOLD )
+	{
+		mul_schoolbook( r, a, n, b, n );
+		return;
+	}
+	
+	// a = a0 + a1 T^h, b = b0 + b1 T^h (T = t^64), where the low halves
+	// have h words and the high halves have g >= h words
+	unsigned int h = n / 2;
+	unsigned int g = n - h;
+	
+	// z0 = a0*b0 and z2 = a1*b1 go straight into the bottom and top of r
+	mul_karatsuba( r, a, b, h );
+	mul_karatsuba( r + 2 * h, a + h, b + h, g );
+	
+	// z1 = ( a0 + a1 )( b0 + b1 ) + z0 + z2 is the middle part
+	std::vector<uint64_t> sa( g ), sb( g ), z1( 2 * g );
+	for( unsigned int k = 0; k < g; k++ )
+	{
+		sa[ k ] = a[ h + k ] ^ ( k < h ? a[ k ] : 0 );
+		sb[ k ] = b[ h + k ] ^ ( k < h ? b[ k ] : 0 );
+	}
+	
+	mul_karatsuba( &z1[ 0 ], &sa[ 0 ], &sb[ 0 ], g );
+	
+	for( unsigned int k = 0; k < 2 * h; k++ )
+		z1[ k ] ^= r[ k ];
+	for( unsigned int k = 0; k < 2 * g; k++ )
+		z1[ k ] ^= r[ 2 * h + k ];
+	
+	for( unsigned int k = 0; k < 2 * g; k++ )
+		r[ h + k ] ^= z1[ k ];
+}
+
+
+// r[ 0 .. la + lb ) = a * b for any sizes. If b is big enough for
+// Karatsuba, a is cut into pieces the size of b and each piece is a
+// balanced product.
+static void mul_words( uint64_t *r, const uint64_t *a, unsigned int la, const uint64_t *b, unsigned int lb )
+{
+	if( la < lb )
+	{
+		std::swap( a, b );
+		std::swap( la, lb );
+	}
+	
+	if( lb < KARATSUBA_THRESHOLD )
+	{
+		mul_schoolbook( r, a, la, b, lb );
+		return;
+	}
+	
+	for( unsigned int k = 0; k < la + lb; k++ )
+		r[ k ] = 0;
+	
+	std::vector<uint64_t> piece( lb ), prod( 2 * lb );
+	for( unsigned int i = 0; i < la; i += lb )
+	{
+		for( unsigned int k = 0; k < lb; k++ )
+			piece[ k ] = i + k < la ? a[ i + k ] : 0;
+		
+		mul_karatsuba( &prod[ 0 ], &piece[ 0 ], b, lb );
+		
+		for( unsigned int k = 0; k < 2 * lb && i + k < la + lb; k++ )
+			r[ i + k ] ^= prod[ k ];
+	}
+}
+
+
 
 // if the poly is newly created, or if something has been added which
 // may result in a lower degree, this function calculates the new degree
 // (and makes sure the vector is the right size)
 unsigned int f2poly_t::find_degree( )
 {
-	unsigned int l = size( ) - 1;
+	normalize( );
+	
+	unsigned int l = words.size( ) - 1;
 	while( l > 0 && !words[ l ] )
 		l--;
 	
@@ -52,7 +718,7 @@ unsigned int f2poly_t::find_degree( )
 
 
 // default constructor: create zero polynomial
-f2poly_t::f2poly_t( ) : words( 1, 0 )
+f2poly_t::f2poly_t( ) : words( 1, 0 ), offset( 0 ), fprint( 0 )
 {
 	degree = 0;
 }
@@ -62,7 +728,7 @@ f2poly_t::f2poly_t( ) : words( 1, 0 )
 // l: number of words
 // bottom: least significant word
 // top word will be 1, all others 0
-f2poly_t::f2poly_t( unsigned int l, uint64_t bottom ) : words( l, 0 )
+f2poly_t::f2poly_t( unsigned int l, uint64_t bottom ) : words( l, 0 ), offset( 0 )
 {
 	words[ 0 ] = bottom;
 	
@@ -73,19 +739,164 @@ f2poly_t::f2poly_t( unsigned int l, uint64_t bottom ) : words( l, 0 )
 		words[ l - 1 ] = 1;
 		degree = WORDLENGTH * ( l - 1 );
 	}
+	
+	refingerprint( );
 }
 
 
 // constructor for array with l words given as a vector argument
-f2poly_t::f2poly_t( std::vector<uint64_t> a ) : words( a )
+f2poly_t::f2poly_t( const std::vector<uint64_t> &a ) : words( a.begin( ), a.end( ) ), offset( 0 )
 {
 	degree = find_degree( );
+	refingerprint( );
 }
 
 
 uint64_t f2poly_t::bottomword( )
 {
-	return words[ 0 ];
+	return word( 0 );
+}
+
+
+f2poly_t::f2poly_t( const f2poly_t &other )
+	: words( other.size( ) ), offset( 0 ), fprint( other.fprint ), degree( other.degree )
+{
+	for( unsigned int k = 0; k < words.size( ); k++ )
+		words[ k ] = other.word( k );
+}
+
+
+f2poly_t::f2poly_t( f2poly_t &&other ) noexcept
+	: words( std::move( other.words ) ), offset( other.offset ),
+	fprint( other.fprint ), degree( other.degree ) { }
+
+
+f2poly_t& f2poly_t::operator=( const f2poly_t &other )
+{
+	if( this == &other )
+		return *this;
+	
+	// (resize( ) only reallocates if the capacity is too small)
+	words.resize( other.size( ) );
+	for( unsigned int k = 0; k < words.size( ); k++ )
+		words[ k ] = other.word( k );
+	
+	offset = 0;
+	fprint = other.fprint;
+	degree = other.degree;
+	
+	return *this;
+}
+
+
+// our old array goes to other, which is about to be destroyed
+f2poly_t& f2poly_t::operator=( f2poly_t &&other ) noexcept
+{
+	words.swap( other.words );
+	std::swap( offset, other.offset );
+	fprint = other.fprint;
+	degree = other.degree;
+	
+	return *this;
+}
+
+
+// copy of the words of the polynomial, with any pending divisions applied
+std::vector<uint64_t> f2poly_t::wordvector( ) const
+{
+	std::vector<uint64_t> a;
+	wordvector( a );
+	
+	return a;
+}
+
+
+void f2poly_t::wordvector( std::vector<uint64_t> &a ) const
+{
+	a.resize( size( ) );
+	for( unsigned int k = 0; k < a.size( ); k++ )
+		a[ k ] = word( k );
+}
+
+
+
+/**********************************************************************/
+/************************* LAZY DIVISION ******************************/
+/**********************************************************************/
+// divide( ) doesn't touch the words; it only counts the number of pending
+// divisions by t in offset. The coefficient of t^k is bit k + offset of
+// the bit array. Anything which changes the words calls normalize( ) first,
+// which applies all the pending divisions in one pass, dropping whole
+// words where it can.
+
+
+void f2poly_t::normalize( )
+{
+	if( !offset )
+		return;
+	
+	unsigned int l = size( );
+	unsigned int skip = offset / WORDLENGTH;
+	unsigned int shift = offset % WORDLENGTH;
+	
+	if( !shift )
+	{
+		// whole words only
+		for( unsigned int k = 0; k < l; k++ )
+			words[ k ] = k + skip < words.size( ) ? words[ k + skip ] : 0;
+	}
+	else
+	{
+		// word( k ) only reads words k + skip and above, so this can be
+		// done in place from the bottom up
+		for( unsigned int k = 0; k < l; k++ )
+			words[ k ] = word( k );
+	}
+	
+	words.resize( l );
+	offset = 0;
+}
+
+
+// number of coefficients at the bottom which are 0, i.e. the number of
+// times we can divide by t exactly (max_degree for the zero polynomial)
+unsigned int f2poly_t::trailing_zeros( ) const
+{
+	for( unsigned int k = 0; k < size( ); k++ )
+	{
+		uint64_t w = word( k );
+		if( w )
+			return WORDLENGTH * k + __builtin_ctzll( w );
+	}
+	
+	return max_degree;
+}
+
+
+// divide by t^k, dropping anything not divisible
+void f2poly_t::divide( unsigned int k )
+{
+	// divide the fingerprint by alpha^k too, after taking off the bits
+	// which are dropped (in practice there are none, or just f(0))
+	bool exact = k < WORDLENGTH ? !( word( 0 ) & ( bits[ k ] - 1 ) ) : trailing_zeros( ) >= k;
+	
+	if( k == 1 )
+		fprint = f2poly_gfdivalpha( fprint ^ parity( ) );
+	else if( exact && k < 3 )
+		for( unsigned int j = 0; j < k; j++ )
+			fprint = f2poly_gfdivalpha( fprint );
+	else if( exact )
+		fprint = f2poly_gfmul( fprint, alpha_power( k, true ) );
+	
+	offset += k;
+	degree = degree > k ? degree - k : 0;
+	
+	// keep single-word polynomials normalized, it costs nothing
+	if( degree < WORDLENGTH )
+		normalize( );
+	
+	if( !exact )
+		refingerprint( );
 }
 
 
@@ -98,22 +909,26 @@ uint64_t f2poly_t::bottomword( )
 
 void f2poly_t::setbit( unsigned int k )
 {
-	words[ k / WORDLENGTH] |= bits[ k % WORDLENGTH ];
+	if( !checkbit( k ) )
+		togglebit( k );
 }
 
 void f2poly_t::clearbit( unsigned int k )                
 {
-	words[ k / WORDLENGTH ] &= ~bits[ k % WORDLENGTH ];
+	if( checkbit( k ) )
+		togglebit( k );
 }
 
 void f2poly_t::togglebit( unsigned int k )
 {
+	normalize( );
 	words[ k / WORDLENGTH ] ^= bits[ k % WORDLENGTH ];
+	fprint ^= alpha_power( k, false );
 }
 
-int f2poly_t::checkbit( unsigned int k )
+int f2poly_t::checkbit( unsigned int k ) const
 {
-	return( ( words[ k / WORDLENGTH ] & bits[ k % WORDLENGTH ] ) != 0 );
+	return( ( word( k / WORDLENGTH ) & bits[ k % WORDLENGTH ] ) != 0 );
 }
 
 
@@ -123,12 +938,18 @@ int f2poly_t::checkbit( unsigned int k )
 /**********************************************************************/
 
 
+// the fingerprints rule out nearly every unequal pair, only equal ones
+// have to be compared word by word
 bool f2poly_t::operator==( const f2poly_t &other ) const
 {
-	if( degree != other.degree )
+	if( fprint != other.fprint || degree != other.degree )
 		return 0;
 	
-	return words == other.words;
+	for( unsigned int k = 0; k < size( ); k++ )
+		if( word( k ) != other.word( k ) )
+			return 0;
+	
+	return 1;
 }
 
 
@@ -139,46 +960,23 @@ bool f2poly_t::operator==( const f2poly_t &other ) const
 // add another f2poly
 f2poly_t& f2poly_t::operator+=( const f2poly_t &other )
 {
-	// save original size of *this in case it changes later
-	unsigned int l = size( );
-	
-	/* three cases:
-		1. other has more words than *this (need to resize *this, copy high words, add low words)
-		2. *this has more words than other (easy, just need to add low words)
-		3. *this and other have same # of words (if they're the same degree, we may have to remove words and find the new degree)
-	*/
-	
-	if( degree < other.degree )
-	{
-		degree = other.degree;
-		
-		// if other has extra words,
-		if( size( ) < other.words.size( ) )
-		{
-			// resize *this
-			words.resize( other.words.size( ) );
-			
-			// copy the extra words over (adding to zero)
-			for( unsigned int k = l; k < size( ); k++ )
-				words[ k ] = other.words[ k ];
-			
-		}
-	}
+	normalize( );
 	
-	// now we add the low words which are nonzero in both polynomials
+	unsigned int l = other.size( );
 	
-	// l = min( original size of *this, size of other )
-	if( l > other.words.size( ) ) l = other.words.size( );
+	// if other has more words than *this, resize *this (the new words are
+	// zero, so adding copies the high words of other over)
+	if( words.size( ) < l )
+		words.resize( l, 0 );
 	
 	for( unsigned int k = 0; k < l; k++ )
-		words[ k ] ^= other.words[ k ];
+		words[ k ] ^= other.word( k );
+	fprint ^= other.fprint;
 	
-	// lastly, if the degrees are exactly equal, some of the top bits will cancel
-	if( other.degree == degree )
-	{	
-		// recalculate degree
+	// if other has at least our degree, the top bits may cancel, and either
+	// way the degree has to be recalculated
+	if( degree <= other.degree )
 		degree = find_degree( );
-	}
 	
 	return *this;
 }
@@ -187,7 +985,25 @@ f2poly_t& f2poly_t::operator+=( const f2poly_t &other )
 // add a long (not wrapped in an f2poly)
 f2poly_t& f2poly_t::operator+=( const uint64_t &a )
 {
+	// with divisions pending the degree is at least WORDLENGTH (see
+	// divide), so a goes into the two words at the offset, below the top
+	if( offset && degree >= WORDLENGTH )
+	{
+		unsigned int j = offset / WORDLENGTH;
+		unsigned int shift = offset % WORDLENGTH;
+		
+		words[ j ] ^= a << shift;
+		if( shift )
+			words[ j + 1 ] ^= a >> ( WORDLENGTH - shift );
+		fprint ^= a;
+		
+		return *this;
+	}
+	
+	normalize( );
+	
 	words[ 0 ] ^= a;
+	fprint ^= a;
 	if( size( ) == 1 )
 		degree = find_degree( );
 		
@@ -198,113 +1014,102 @@ f2poly_t& f2poly_t::operator+=( const uint64_t &a )
 // multiply by low degree polynomial m
 f2poly_t& f2poly_t::operator*=( const uint64_t &m )
 {
-	// If l = 1 (i.e. the bitarray is a single word), we can just xor f
-	// with itself shifted left by various values. But if not, we also
-	// have to 'carry over' the bits at the edges of words.
-	
 	unsigned int md = ilog2( m );
 	
-	unsigned int l = words.size( );
+	normalize( );
 	
-	// do we need to increase the array size and add a new word? (word l)
-	if( ( degree + md ) / WORDLENGTH > degree / WORDLENGTH )
-	{
-		uint64_t new_word = 0;
-		
-		// take highest (md) bits
-		uint64_t carryover = words[ size( ) - 1 ] >> ( WORDLENGTH - md );
-		
-		
-		// for each index i such that f_i == 1
-		for( unsigned int i = 0; i < md; i++ )
-		{
-			if( m & bits[ md - i ] )
-			{
-				// shift carryover this much and add (xor)
-				new_word ^= ( carryover >> i );	
-			}
-		}
-		
-		words.push_back( new_word );
-	}
-	
-	// do words l-1 down to 1
-	for( unsigned int k = l - 1; k > 0; k-- ) // start from highest word in f
-	{
-		// save a copy of current word
-		uint64_t new_word = 0;
-		
-		// take highest (md) bits of next word
-		uint64_t carryover = words[ k - 1 ] >> ( WORDLENGTH - md );	
-		
-		// for each index i such that f_i == 1
-		for( unsigned int i = 0; i <= md; i++ )
-			if( m & bits[ i ] )
-			{
-				new_word ^= ( words[ k ] << i ); // xor with itself shifted left
-				new_word ^= ( carryover >> i );	// xor with top bits from next word
-			}
-			
-		words[ k ] = new_word;
-	}
+	// multiply every word in place; the kernel hands back the bits which
+	// were carried out of the top word
+	uint64_t carryover = mulkernel( &words[ 0 ], words.size( ), m );
 	
-	// do word 0
-	uint64_t new_word = 0;
-	for( unsigned int i = 0; i <= md; i++ )
-		if( m & bits[ i ] )
-			new_word ^= ( words[ 0 ] << i );
-	words[ 0 ] = new_word;
+	// do we need to increase the array size and add a new word?
+	if( ( degree + md ) / WORDLENGTH > degree / WORDLENGTH )
+		words.push_back( carryover );
 	
 	// update degree
-	degree += md;
+	degree = m ? degree + md : 0;
+	fprint = f2poly_gfmul( fprint, m );
 	
 	return *this;
 }
 
 
 
-void f2poly_t::divide( )
+// multiply by another polynomial (of any size)
+f2poly_t& f2poly_t::operator*=( const f2poly_t &other )
 {
+	// a single word multiplier is done in place
+	if( other.size( ) == 1 )
+		return *this *= other.word( 0 );
 	
-	// do all words except the most significant, starting from word 0.
-	unsigned int top = size( ) - 1;
-	for( unsigned int k = 0; k < top; k++ )
-	{
-		// shift right, and shift over the lowest bit from the next word
-		words[ k ] >>= 1;
-		words[ k ] ^= ( words[ k + 1 ] % 2 ) ? bits[ WORDLENGTH - 1 ] : 0;
-	}
+	normalize( );
 	
-	if( top > 0 && degree % WORDLENGTH == 0 ) // if the top word is just a 1
-	{
-		words.resize( top );	// shrink the vector
-	}
-	else
+	// other may have pending divisions too (or be *this)
+	static thread_local std::vector<uint64_t> b;
+	const uint64_t *bw = &other.words[ 0 ];
+	if( other.offset )
 	{
-		words[ top ] >>= 1; 	// otherwise, shift the top word
+		other.wordvector( b );
+		bw = &b[ 0 ];
 	}
 	
-	if( degree )
-		degree--;
+	// the product goes into a scratch buffer which is then swapped with
+	// words, so in the long run neither one is reallocated
+	static thread_local f2poly_words_t product;
+	product.resize( words.size( ) + other.size( ) );
+	
+	mul_words( &product[ 0 ], &words[ 0 ], words.size( ), bw, other.size( ) );
+	
+	words.swap( product );
+	degree = find_degree( );
+	fprint = f2poly_gfmul( fprint, other.fprint );
 	
+	return *this;
 }
 
 
-int f2poly_t::parity( )
+// the product f*m has degree + deg m, and the division by t takes one off
+// (f is odd, so adding 1 can't cancel the top unless f*m = 1)
+void f2poly_t::mxplus1( const uint64_t &m )
 {
-	return checkbit( 0 );
+	unsigned int d = degree + topbit( m );
+	unsigned int l = ( d ? d - 1 : 0 ) / WORDLENGTH + 1;	// words in the result
+	
+	// at most one reallocation, only if the result is longer than the
+	// storage we already have
+	if( words.size( ) < l )
+		words.resize( l, 0 );
+	
+	uint64_t fm = mx1kernel( &words[ 0 ], words.size( ), offset, l, m, fprint );
+	
+	words.resize( l );
+	offset = 0;
+	
+	if( l == 1 )
+		degree = topbit( words[ 0 ] );
+	else
+		degree = d - 1;
+	
+	// (f*m + 1 - dropped bit) / t, the dropped bit being m(0) + 1
+	fprint = f2poly_gfdivalpha( fm ^ ( m & 1 ) );
+}
+
+
+void f2poly_t::divide( )
+{
+	divide( 1 );
 }
 
 
 bool f2poly_t::is_zero( )
 {
-	return size( ) == 1 && !words[ 0 ];
+	return size( ) == 1 && !word( 0 );
 }
 
 
 bool f2poly_t::is_one( )
 {
-	return size( ) == 1 && words[ 0 ] == 1;
+	return size( ) == 1 && word( 0 ) == 1;
 }
 
 
@@ -317,14 +1122,16 @@ bool f2poly_t::is_one( )
 // set all words to 0
 void f2poly_t::reset( )
 {
-	for( unsigned int k = 0; k < size( ); k++ )
+	for( unsigned int k = 0; k < words.size( ); k++ )
 		words[ k ] = 0;
 	degree = 0;
+	offset = 0;
+	fprint = 0;
 }
 
 
 // print array as list of words in binary form (little-endian)
-void f2poly_t::print( )
+void f2poly_t::print( ) const
 {
 	for( unsigned int k = 0; k <= degree; k++ )
 	{
@@ -336,25 +1143,25 @@ void f2poly_t::print( )
 
 
 // print array as list of words in hex form
-void f2poly_t::printhex( )
+void f2poly_t::printhex( ) const
 {
-	printf( "%#lx", words[ 0 ] );
+	printf( "%#lx", word( 0 ) );
 	for( unsigned int i = 1; i < size( ); i++ )
-		printf( ".%#lx", words[ i ] );
+		printf( ".%#lx", word( i ) );
 }
 
 
 // print array as list of words in integer form
-void f2poly_t::printdec( )
+void f2poly_t::printdec( ) const
 {
-	printf( "%lu", words[ 0 ] );
+	printf( "%lu", word( 0 ) );
 	for( unsigned int i = 1; i < size( ); i++ )
-		printf( ".%lu", words[ i ] );
+		printf( ".%lu", word( i ) );
 }
 
 
 // print polynomial in expanded form
-void f2poly_t::printpoly( )
+void f2poly_t::printpoly( ) const
 {
 	printf( "%i", checkbit( 0 ) );
 	
@@ -367,5 +1174,42 @@ void f2poly_t::printpoly( )
 }
 
 
-
-
+// read a polynomial from a string, either as a single number (decimal, or
+// hex with any number of digits) or as words separated by dots, least
+// significant first, in the form printed by printhex( ) or printdec( )
+f2poly_t f2poly_parse( const char *s )
+{
+	std::vector<uint64_t> a;
+	
+	if( s == NULL || !*s )
+		return f2poly_t( );
+	
+	// long hex number: 16 digits per word, from the right
+	if( s[ 0 ] == '0' && ( s[ 1 ] == 'x' || s[ 1 ] == 'X' ) && !strchr( s, '.' ) )
+	{
+		const char *digits = s + 2;
+		int n = strlen( digits );
+		
+		for( int end = n; end > 0; end -= 16 )
+		{
+			int start = end > 16 ? end - 16 : 0;
+			std::string piece( digits + start, digits + end );
+			a.push_back( strtoul( piece.c_str( ), NULL, 16 ) );
+		}
+		
+		return f2poly_t( a );
+	}
+	
+	// dotted words (a single word is just a number)
+	const char *p = s;
+	while( true )
+	{
+		char *next;
+		a.push_back( strtoul( p, &next, 0 ) );
+		if( *next != '.' )
+			break;
+		p = next + 1;
+	}
+	
+	return f2poly_t( a );
+}
@@ -5,7 +5,8 @@
  * (F_2 is the finite field of 2 elements)
  * 
  * Polynomial is stored as a vector of unsigned longs, with each bit
- * representing a coefficient
+ * representing a coefficient. Division by t is lazy: it only bumps a bit
+ * offset, which is applied to the words the next time they are changed.
  * 
  */
 
@@ -13,6 +14,7 @@
 #ifndef F2POLY_H
 #define F2POLY_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -24,45 +26,284 @@ extern const uint64_t bits[WORDLENGTH]; // masks for each bit
 unsigned int ilog2( uint64_t x );
 
 
+// position of the most significant 1 bit (0 for x = 0), like ilog2( )
+inline unsigned int topbit( uint64_t x )
+{
+	return x ? WORDLENGTH - 1 - __builtin_clzll( x ) : 0;
+}
+
+
+// product of a word and a low degree polynomial m, without reduction:
+// returns the low word and stores the high word in *hi. Only loops over
+// the 1 bits of m, which are usually very few.
+inline uint64_t mulword( uint64_t a, uint64_t m, uint64_t *hi )
+{
+	uint64_t lo = 0;
+	*hi = 0;
+
+	while( m )
+	{
+		unsigned int i = __builtin_ctzll( m );
+		lo ^= a << i;
+		if( i ) *hi ^= a >> ( WORDLENGTH - i );
+		m &= m - 1;
+	}
+
+	return lo;
+}
+
+
+// A multiplier m of degree < 64, prepared for being used over and over:
+// the positions of its 1 bits when it has at most three of them, and its
+// products with all the polynomials of degree < 4. See
+// f2poly_multiplier.h for how these are put to use.
+struct f2poly_mword_t
+{
+	uint64_t m;
+	unsigned int terms;			// number of 1 bits of m
+	unsigned int shift[ 3 ];	// positions of the lowest three of them
+	uint64_t lo[ 16 ];			// m * n for deg n < 4: low word...
+	uint64_t hi[ 16 ];			// ... and the bits carried into the next
+
+	f2poly_mword_t( uint64_t a = 0 );
+};
+
+
+// Word products a * m, returning the low word and storing the high word in
+// *hi (the same thing as mulword( a, m.m, hi )), one for each shape of m.
+// The polynomial classes are templated over these in mul_by( ) and
+// mxplus1_by( ).
+
+// one shifted xor for each 1 bit of m
+struct f2poly_mulword_loop_t
+{
+	static uint64_t mul( uint64_t a, const f2poly_mword_t &m, uint64_t *hi )
+	{
+		return mulword( a, m.m, hi );
+	}
+};
+
+// m with exactly K terms: unrolled shifted xors
+template< unsigned int K >
+struct f2poly_mulword_sparse_t
+{
+	static uint64_t mul( uint64_t a, const f2poly_mword_t &m, uint64_t *hi )
+	{
+		uint64_t lo = 0;
+		*hi = 0;
+
+		for( unsigned int i = 0; i < K; i++ )
+		{
+			lo ^= a << m.shift[ i ];
+			*hi ^= ( a >> 1 ) >> ( WORDLENGTH - 1 - m.shift[ i ] );	// (no shift by 64)
+		}
+
+		return lo;
+	}
+};
+
+// dense m: a is taken 4 bits at a time, looking up the products in a table
+struct f2poly_mulword_table_t
+{
+	static uint64_t mul( uint64_t a, const f2poly_mword_t &m, uint64_t *hi )
+	{
+		uint64_t lo = m.lo[ a & 15 ];
+		uint64_t h = m.hi[ a & 15 ];
+
+		for( unsigned int j = 4; j < WORDLENGTH; j += 4 )
+		{
+			unsigned int n = ( a >> j ) & 15;
+			lo ^= m.lo[ n ] << j;
+			h ^= ( m.lo[ n ] >> ( WORDLENGTH - j ) ) ^ ( m.hi[ n ] << j );
+		}
+
+		*hi = h;
+		return lo;
+	}
+};
+
+// carry-less multiply instruction (only used if f2poly_has_clmul( ))
+uint64_t f2poly_clmulword( uint64_t a, uint64_t m, uint64_t *hi );
+
+struct f2poly_mulword_clmul_t
+{
+	static uint64_t mul( uint64_t a, const f2poly_mword_t &m, uint64_t *hi )
+	{
+		return f2poly_clmulword( a, m.m, hi );
+	}
+};
+
+
+
+// Fingerprints. A polynomial f is fingerprinted by its value f(alpha) in
+// GF(2^64) = F_2[t]/(P), where alpha is the class of t: that is, by f mod
+// P. It can be kept up to date as f changes: multiplying f by m multiplies
+// it by m(alpha), adding two polynomials adds their fingerprints, and
+// dividing f by t divides it by alpha. Comparing fingerprints settles
+// almost every comparison in one step, and they make cheap hash keys.
+//
+// P is an irreducible polynomial of degree 64 drawn at random (t^64 + r,
+// r being the first word of the splitmix64 stream from seed 1 which makes
+// it irreducible), which comes to the same as evaluating at a random point
+// of GF(2^64): two polynomials of degree < n have the same fingerprint only
+// if P divides their difference, as at most n/64 of the 2^58 irreducible
+// polynomials of degree 64 do. A sparse P such as t^64 + t^4 + t^3 + t + 1
+// would be cheaper to reduce by, but f and f + P would always collide, and
+// a multiplier divisible by P (P itself, say) would send every odd term to
+// the same fingerprint. P is fixed rather than drawn on each run because
+// the cycle catalogue keeps hashes from one run to the next.
+#define FINGERPRINT_POLY 0xfd845ef300ce2d0b	// P - t^64
+#define FINGERPRINT_MU 0x82e2d8166f33547e	// t^128 / P - t^64, for reducing
+
+uint64_t f2poly_gfmul( uint64_t a, uint64_t b );	// product in GF(2^64)
+
+// reduce the product lo + t^64 hi mod P
+uint64_t f2poly_gfreduce( uint64_t lo, uint64_t hi );
+
+uint64_t f2poly_fingerprint( const uint64_t *w, unsigned int l );	// of l words
+
+// h / alpha
+inline uint64_t f2poly_gfdivalpha( uint64_t h )
+{
+	uint64_t odd = -( h & 1 );	// then add P first, so it can be divided by t
+	return ( ( h ^ ( odd & FINGERPRINT_POLY ) ) >> 1 ) | ( odd << ( WORDLENGTH - 1 ) );
+}
+
+
+
+// The word arrays of f2poly_t come from a per-thread pool: arrays which
+// are freed go on a free list for their size class (a power of 2 words)
+// and are handed out again from there. Once the pool is warmed up, copying
+// and growing polynomials only goes to the system allocator for an array
+// bigger than any the thread has used before. The free arrays go back to
+// the system allocator when the thread exits.
+void *f2poly_pool_alloc( std::size_t n );			// n words
+void f2poly_pool_free( void *p, std::size_t n );	// ... and back again
+
+template< class T >
+struct f2poly_allocator_t
+{
+	typedef T value_type;
+
+	f2poly_allocator_t( ) { }
+	template< class U > f2poly_allocator_t( const f2poly_allocator_t<U> & ) { }
+
+	T *allocate( std::size_t n )
+	{
+		return static_cast< T* >( f2poly_pool_alloc( ( n * sizeof( T ) + 7 ) / 8 ) );
+	}
+
+	void deallocate( T *p, std::size_t n )
+	{
+		f2poly_pool_free( p, ( n * sizeof( T ) + 7 ) / 8 );
+	}
+};
+
+template< class T, class U >
+inline bool operator==( const f2poly_allocator_t<T> &, const f2poly_allocator_t<U> & ) { return true; }
+template< class T, class U >
+inline bool operator!=( const f2poly_allocator_t<T> &, const f2poly_allocator_t<U> & ) { return false; }
+
+typedef std::vector< uint64_t, f2poly_allocator_t< uint64_t > > f2poly_words_t;
+
+
+
+// multiply kernel: multiplies the l words at w by m (deg m < 64) in place
+// and returns the word carried out of the top. The kernel is chosen at
+// startup (PCLMULQDQ / VPCLMULQDQ when the CPU has them, otherwise a
+// portable bit loop); all of them give identical results.
+typedef uint64_t (*f2poly_mulkernel_t)( uint64_t *w, unsigned int l, uint64_t m );
+
+extern f2poly_mulkernel_t mulkernel;
+
+const char *f2poly_kernel_name( );	// name of the kernel in use
+bool f2poly_has_clmul( );			// is it a carry-less multiply?
+
+
 
 class f2poly_t
 {
 	private:
 		// vector of words representing a bit array
-		std::vector<uint64_t> words;
+		f2poly_words_t words;
+		
+		// number of divisions by t not yet applied to words; the
+		// coefficient of t^k is bit (k + offset) of the array
+		unsigned int offset;
+		
+		uint64_t fprint;		// f mod P (see above), kept up to date
+		
+		void normalize( );		// apply the pending divisions
+		void refingerprint( );	// compute fprint from scratch
 		
 	public:
+		static const unsigned int max_degree = ~0u;	// no limit (see f2poly_fixed)
+		
 		unsigned int degree;	// (most significant 1 bit)
 		
-		unsigned int size( ) { return words.size( ); }	// number of words used
+		unsigned int size( ) const { return degree / WORDLENGTH + 1; }	// number of words used
 		unsigned int find_degree( );					// set degree
 		
 		f2poly_t( );								 // zero polynomial
 		f2poly_t( unsigned int l, uint64_t bottom ); // # words and bottom word
-		f2poly_t( std::vector<uint64_t> a ); 		 // all words
+		f2poly_t( const std::vector<uint64_t> &a );	 // all words
+		
+		// copies only take the words in use (with any pending divisions
+		// applied), and assignment keeps the array it already has if it's
+		// big enough; a moved-from polynomial can only be assigned to or
+		// destroyed
+		f2poly_t( const f2poly_t &other );
+		f2poly_t( f2poly_t &&other ) noexcept;
+		f2poly_t& operator=( const f2poly_t &other );
+		f2poly_t& operator=( f2poly_t &&other ) noexcept;
+		
+		// k-th word of the polynomial (taking the offset into account)
+		uint64_t word( unsigned int k ) const
+		{
+			unsigned int j = k + offset / WORDLENGTH;
+			unsigned int shift = offset % WORDLENGTH;
+			
+			uint64_t w = j < words.size( ) ? words[ j ] >> shift : 0;
+			if( shift && j + 1 < words.size( ) )
+				w |= words[ j + 1 ] << ( WORDLENGTH - shift );
+			return w;
+		}
+		
+		std::vector<uint64_t> wordvector( ) const;
+		void wordvector( std::vector<uint64_t> &a ) const;	// (reusing a)
+		
+		uint64_t fingerprint( ) const { return fprint; }	// also a hash key
 		
 		// these four functions are used to set (to 1), clear (to 0), toggle, or
 		// check a specific digit in a bit array
 		void setbit( unsigned int k );
 		void clearbit( unsigned int k );
 		void togglebit( unsigned int k );
-		int checkbit( unsigned int k );
+		int checkbit( unsigned int k ) const;
 		
 		uint64_t bottomword( );		// return least significant word
 
-		void divide( );			// divide by t
+		void divide( );					// divide by t
+		void divide( unsigned int k );	// divide by t^k
+		unsigned int trailing_zeros( ) const;	// largest k such that t^k | f
+		
+		// return f(0)
+		int parity( ) const
+		{
+			unsigned int j = offset / WORDLENGTH;
+			return j < words.size( ) ? ( words[ j ] >> ( offset % WORDLENGTH ) ) & 1 : 0;
+		}
 		
-		int parity( );			// return f(0)
 		bool is_zero( );
 		bool is_one( );
 		
 		void reset( );			// reset all words to zero
 		
 		// display polynomial in different formats
-		void print( );
-		void printhex( );
-		void printdec( );
-		void printpoly( );
+		void print( ) const;
+		void printhex( ) const;
+		void printdec( ) const;
+		void printpoly( ) const;
 		
 		
 		// operators
@@ -70,12 +311,117 @@ class f2poly_t
 		f2poly_t& operator+=( const f2poly_t &other );
 		f2poly_t& operator+=( const uint64_t &a );
 		f2poly_t& operator*=( const uint64_t &m );
+		f2poly_t& operator*=( const f2poly_t &other );
 		
+		// replace f by ( f*m + 1 ) / t, for odd f. Same as
+		//     f = f * m + 1;  f.divide( );
+		// but done in place, in a single pass over the words
+		void mxplus1( const uint64_t &m );
+
+		// the same two, with the word products done by W (see above)
+		template< class W > f2poly_t& mul_by( const f2poly_mword_t &m );
+		template< class W > void mxplus1_by( const f2poly_mword_t &m );
+
 		~f2poly_t( ) { }
 };
 
 
 
+// multiply by m in place, the same way as operator*=( uint64_t )
+template< class W >
+f2poly_t& f2poly_t::mul_by( const f2poly_mword_t &m )
+{
+	unsigned int md = topbit( m.m );
+
+	normalize( );
+
+	uint64_t carryover = 0;
+	for( unsigned int k = 0; k < words.size( ); k++ )
+	{
+		uint64_t hi;
+		uint64_t lo = W::mul( words[ k ], m, &hi );
+
+		words[ k ] = lo ^ carryover;
+		carryover = hi;
+	}
+
+	if( ( degree + md ) / WORDLENGTH > degree / WORDLENGTH )
+		words.push_back( carryover );
+
+	degree = m.m ? degree + md : 0;
+
+	uint64_t fhi;
+	uint64_t flo = W::mul( fprint, m, &fhi );
+	fprint = f2poly_gfreduce( flo, fhi );
+
+	return *this;
+}
+
+
+// ( f*m + 1 ) / t in a single pass, like mxplus1( ): word k of the result
+// is written once word k + 1 of f has been read. The words of f are read
+// straight from the array at the pending offset; padding the array with
+// zero words first takes the bounds checks out of the loop.
+template< class W >
+void f2poly_t::mxplus1_by( const f2poly_mword_t &m )
+{
+	unsigned int d = degree + topbit( m.m );
+	unsigned int l = ( d ? d - 1 : 0 ) / WORDLENGTH + 1;
+	unsigned int skip = offset / WORDLENGTH;
+	unsigned int shift = offset % WORDLENGTH;
+
+	if( words.size( ) < l + skip + 2 )
+		words.resize( l + skip + 2, 0 );
+
+	uint64_t *w = &words[ 0 ];
+	const uint64_t *src = w + skip;
+
+	// (the second shift is split in two so that shift = 0 works)
+	uint64_t hi;
+	uint64_t a = ( src[ 0 ] >> shift ) | ( ( src[ 1 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+	uint64_t p = W::mul( a, m, &hi ) ^ 1;
+
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		a = ( src[ k + 1 ] >> shift ) | ( ( src[ k + 2 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+
+		uint64_t carryover = hi;
+		uint64_t p_next = W::mul( a, m, &hi ) ^ carryover;
+
+		w[ k ] = ( p >> 1 ) | ( p_next << ( WORDLENGTH - 1 ) );
+		p = p_next;
+	}
+
+	words.resize( l );
+	offset = 0;
+
+	if( l == 1 )
+		degree = topbit( words[ 0 ] );
+	else
+		degree = d - 1;
+
+	// the bit dropped by the division is m(0) + 1
+	uint64_t flo = W::mul( fprint, m, &hi );
+	fprint = f2poly_gfdivalpha( f2poly_gfreduce( flo, hi ) ^ ( m.m & 1 ) );
+}
+
+
+// with a carry-less multiply, the kernels picked at startup already use it
+// for whole arrays of words
+template< >
+inline f2poly_t& f2poly_t::mul_by< f2poly_mulword_clmul_t >( const f2poly_mword_t &m )
+{
+	return *this *= m.m;
+}
+
+template< >
+inline void f2poly_t::mxplus1_by< f2poly_mulword_clmul_t >( const f2poly_mword_t &m )
+{
+	mxplus1( m.m );
+}
+
+
+
 
 /**********************************************************************/
 /************************** BINARY OPERATORS **************************/
@@ -94,6 +440,10 @@ inline const f2poly_t operator+( uint64_t lhs, const f2poly_t& rhs ) {
 	return rhs + lhs;
 }
 
+inline const f2poly_t operator*( f2poly_t lhs, const f2poly_t& rhs ) {
+	return f2poly_t( lhs ) *= rhs;
+}
+
 inline const f2poly_t operator*( f2poly_t lhs, uint64_t rhs ) {
 	return f2poly_t( lhs ) *= rhs;
 }
@@ -105,5 +455,9 @@ inline const f2poly_t operator*( uint64_t lhs, const f2poly_t& rhs ) {
 
 
 
+// read a polynomial written as a number, or as dotted words like printhex
+f2poly_t f2poly_parse( const char *s );
+
+
 
 #endif
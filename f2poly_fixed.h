@@ -0,0 +1,506 @@
+/* f2poly_fixed
+ *
+ * Defines a class template f2poly_fixed<N> representing a polynomial in
+ * F_2[t] of degree < 64*N, stored inline as N words (so it never touches
+ * the heap). It has the same interface as f2poly_t, so the sequence
+ * classes and the cycle finding code can run on either one.
+ *
+ * All loops run over the N words with a trip count known at compile time,
+ * so the compiler unrolls them completely. N = 1 is specialized separately
+ * as a single-word fast path; N = 2 and N = 4 are the other widths used by
+ * the cycle finding code.
+ *
+ * It is up to the caller to make sure the degree stays below 64*N: before
+ * each step the sequence classes check fits( ), and the cycle finding code
+ * promotes a trajectory to the next wider type (see f2poly_wider below)
+ * as soon as it stops fitting.
+ *
+ */
+
+
+#ifndef F2POLY_FIXED_H
+#define F2POLY_FIXED_H
+
+#include "f2poly.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+
+template< unsigned int N >
+class f2poly_fixed
+{
+	private:
+		uint64_t words[ N ];	// bit array; words above the degree are 0
+
+	public:
+		static const unsigned int max_degree = WORDLENGTH * N - 1;
+
+		unsigned int degree;	// (most significant 1 bit)
+
+		unsigned int size( ) const { return degree / WORDLENGTH + 1; }	// number of words used
+		unsigned int find_degree( );
+
+		f2poly_fixed( );								// zero polynomial
+		f2poly_fixed( unsigned int l, uint64_t bottom );	// # words and bottom word
+		f2poly_fixed( const std::vector<uint64_t> &a );	// all words (at most N)
+
+		std::vector<uint64_t> wordvector( ) const;		// copy of the used words
+		void wordvector( std::vector<uint64_t> &a ) const;	// (reusing a)
+		uint64_t fingerprint( ) const { return f2poly_fingerprint( words, N ); }	// as f2poly_t
+
+		int checkbit( unsigned int k ) const { return ( words[ k / WORDLENGTH ] >> ( k % WORDLENGTH ) ) & 1; }
+		uint64_t bottomword( ) { return words[ 0 ]; }
+
+		void divide( );					// divide by t
+		void divide( unsigned int k );	// divide by t^k
+		unsigned int trailing_zeros( ) const;
+
+		int parity( ) { return words[ 0 ] & 1; }
+		bool is_zero( ) { return degree == 0 && words[ 0 ] == 0; }
+		bool is_one( ) { return degree == 0 && words[ 0 ] == 1; }
+
+		void print( ) const;
+		void printhex( ) const;
+		void printdec( ) const;
+
+		bool operator==( const f2poly_fixed &other ) const;
+		f2poly_fixed& operator+=( const f2poly_fixed &other );
+		f2poly_fixed& operator+=( const uint64_t &a );
+		f2poly_fixed& operator*=( const uint64_t &m );
+
+		// wide operands (these still have to fit)
+		f2poly_fixed& operator+=( const f2poly_t &a );
+		f2poly_fixed& operator*=( const f2poly_t &m );
+
+		// replace f by ( f*m + 1 ) / t (f odd)
+		void mxplus1( const uint64_t &m ) { *this *= m; *this += 1; divide( ); }
+
+		// the same with the word products done by W (see f2poly.h)
+		template< class W > f2poly_fixed& mul_by( const f2poly_mword_t &m );
+		template< class W > void mxplus1_by( const f2poly_mword_t &m ) { mul_by< W >( m ); *this += 1; divide( ); }
+};
+
+
+
+// single word: every operation is one or two instructions
+template< >
+class f2poly_fixed< 1 >
+{
+	private:
+		uint64_t word;
+
+	public:
+		static const unsigned int max_degree = WORDLENGTH - 1;
+
+		unsigned int degree;
+
+		unsigned int size( ) const { return 1; }
+		unsigned int find_degree( ) { return topbit( word ); }
+
+		f2poly_fixed( ) : word( 0 ), degree( 0 ) { }
+		f2poly_fixed( unsigned int l, uint64_t bottom )
+			: word( l > 1 ? 0 : bottom ), degree( topbit( word ) ) { }
+		f2poly_fixed( const std::vector<uint64_t> &a )
+			: word( a.empty( ) ? 0 : a[ 0 ] ), degree( topbit( word ) ) { }
+
+		std::vector<uint64_t> wordvector( ) const { return std::vector<uint64_t>( 1, word ); }
+		void wordvector( std::vector<uint64_t> &a ) const { a.assign( 1, word ); }
+		uint64_t fingerprint( ) const { return word; }
+
+		int checkbit( unsigned int k ) const { return ( word >> k ) & 1; }
+		uint64_t bottomword( ) { return word; }
+
+		void divide( ) { word >>= 1; if( degree ) degree--; }
+
+		void divide( unsigned int k )
+		{
+			word = k < WORDLENGTH ? word >> k : 0;
+			degree = degree > k ? degree - k : 0;
+		}
+
+		unsigned int trailing_zeros( ) const { return word ? __builtin_ctzll( word ) : max_degree; }
+
+		int parity( ) { return word & 1; }
+		bool is_zero( ) { return !word; }
+		bool is_one( ) { return word == 1; }
+
+		void print( ) const;
+		void printhex( ) const { printf( "%#lx", word ); }
+		void printdec( ) const { printf( "%lu", word ); }
+
+		bool operator==( const f2poly_fixed &other ) const { return word == other.word; }
+
+		f2poly_fixed& operator+=( const f2poly_fixed &other )
+		{
+			word ^= other.word;
+			degree = topbit( word );
+			return *this;
+		}
+
+		f2poly_fixed& operator+=( const uint64_t &a )
+		{
+			word ^= a;
+			degree = topbit( word );
+			return *this;
+		}
+
+		f2poly_fixed& operator*=( const uint64_t &m )
+		{
+			uint64_t hi;
+			word = mulword( word, m, &hi );
+			degree = topbit( word );
+			return *this;
+		}
+
+		f2poly_fixed& operator+=( const f2poly_t &a ) { return *this += a.word( 0 ); }
+		f2poly_fixed& operator*=( const f2poly_t &m ) { return *this *= m.word( 0 ); }
+
+		void mxplus1( const uint64_t &m )
+		{
+			uint64_t hi;
+			word = ( mulword( word, m, &hi ) ^ 1 ) >> 1;
+			degree = topbit( word );
+		}
+		template< class W > f2poly_fixed& mul_by( const f2poly_mword_t &m )
+		{
+			uint64_t hi;
+			word = W::mul( word, m, &hi );
+			degree = topbit( word );
+			return *this;
+		}
+
+		template< class W > void mxplus1_by( const f2poly_mword_t &m )
+		{
+			uint64_t hi;
+			word = ( W::mul( word, m, &hi ) ^ 1 ) >> 1;
+			degree = topbit( word );
+		}
+};
+
+
+
+// the words of f (of any of the polynomial types) in a buffer which is
+// reused, so that converting from one type to another doesn't allocate.
+// It is overwritten by the next call.
+template< class P >
+inline const std::vector<uint64_t>& f2poly_words( const P &f )
+{
+	static thread_local std::vector<uint64_t> a;
+	f.wordvector( a );
+	return a;
+}
+
+
+
+// the type a trajectory is promoted to when it outgrows f2poly_fixed<N>
+template< class P > struct f2poly_wider { typedef f2poly_t type; };
+template< > struct f2poly_wider< f2poly_fixed<1> > { typedef f2poly_fixed<2> type; };
+template< > struct f2poly_wider< f2poly_fixed<2> > { typedef f2poly_fixed<4> type; };
+
+
+
+/**********************************************************************/
+/************************** BINARY OPERATORS **************************/
+/**********************************************************************/
+
+
+template< unsigned int N >
+inline const f2poly_fixed<N> operator+( f2poly_fixed<N> lhs, const f2poly_fixed<N> &rhs ) {
+	return lhs += rhs;
+}
+
+template< unsigned int N >
+inline const f2poly_fixed<N> operator+( f2poly_fixed<N> lhs, uint64_t rhs ) {
+	return lhs += rhs;
+}
+
+template< unsigned int N >
+inline const f2poly_fixed<N> operator*( f2poly_fixed<N> lhs, uint64_t rhs ) {
+	return lhs *= rhs;
+}
+
+template< unsigned int N >
+inline const f2poly_fixed<N> operator*( f2poly_fixed<N> lhs, const f2poly_t &rhs ) {
+	return lhs *= rhs;
+}
+
+
+
+/**********************************************************************/
+/************************** IMPLEMENTATION ****************************/
+/**********************************************************************/
+
+
+template< unsigned int N >
+unsigned int f2poly_fixed<N>::find_degree( )
+{
+	unsigned int l = N - 1;
+	while( l > 0 && !words[ l ] )
+		l--;
+
+	return WORDLENGTH * l + topbit( words[ l ] );
+}
+
+
+template< unsigned int N >
+f2poly_fixed<N>::f2poly_fixed( ) : degree( 0 )
+{
+	for( unsigned int k = 0; k < N; k++ )
+		words[ k ] = 0;
+}
+
+
+// same as f2poly_t: bottom word, and a 1 in the top word if l > 1
+template< unsigned int N >
+f2poly_fixed<N>::f2poly_fixed( unsigned int l, uint64_t bottom )
+{
+	for( unsigned int k = 0; k < N; k++ )
+		words[ k ] = 0;
+
+	words[ 0 ] = bottom;
+	if( l > 1 && l <= N )
+		words[ l - 1 ] = 1;
+
+	degree = find_degree( );
+}
+
+
+template< unsigned int N >
+f2poly_fixed<N>::f2poly_fixed( const std::vector<uint64_t> &a )
+{
+	for( unsigned int k = 0; k < N; k++ )
+		words[ k ] = k < a.size( ) ? a[ k ] : 0;
+
+	degree = find_degree( );
+}
+
+
+template< unsigned int N >
+std::vector<uint64_t> f2poly_fixed<N>::wordvector( ) const
+{
+	return std::vector<uint64_t>( words, words + degree / WORDLENGTH + 1 );
+}
+
+
+template< unsigned int N >
+void f2poly_fixed<N>::wordvector( std::vector<uint64_t> &a ) const
+{
+	a.assign( words, words + degree / WORDLENGTH + 1 );
+}
+
+
+template< unsigned int N >
+void f2poly_fixed<N>::divide( )
+{
+	for( unsigned int k = 0; k + 1 < N; k++ )
+		words[ k ] = ( words[ k ] >> 1 ) | ( words[ k + 1 ] << ( WORDLENGTH - 1 ) );
+	words[ N - 1 ] >>= 1;
+
+	if( degree )
+		degree--;
+}
+
+
+template< unsigned int N >
+void f2poly_fixed<N>::divide( unsigned int k )
+{
+	unsigned int skip = k / WORDLENGTH;
+	unsigned int shift = k % WORDLENGTH;
+
+	for( unsigned int j = 0; j < N; j++ )
+	{
+		uint64_t w = j + skip < N ? words[ j + skip ] >> shift : 0;
+		if( shift && j + skip + 1 < N )
+			w |= words[ j + skip + 1 ] << ( WORDLENGTH - shift );
+		words[ j ] = w;
+	}
+
+	degree = degree > k ? degree - k : 0;
+}
+
+
+template< unsigned int N >
+unsigned int f2poly_fixed<N>::trailing_zeros( ) const
+{
+	for( unsigned int k = 0; k < N; k++ )
+		if( words[ k ] )
+			return WORDLENGTH * k + __builtin_ctzll( words[ k ] );
+
+	return max_degree;
+}
+
+
+template< unsigned int N >
+bool f2poly_fixed<N>::operator==( const f2poly_fixed &other ) const
+{
+	if( degree != other.degree )
+		return 0;
+
+	for( unsigned int k = 0; k < N; k++ )
+		if( words[ k ] != other.words[ k ] )
+			return 0;
+
+	return 1;
+}
+
+
+template< unsigned int N >
+f2poly_fixed<N>& f2poly_fixed<N>::operator+=( const f2poly_fixed &other )
+{
+	for( unsigned int k = 0; k < N; k++ )
+		words[ k ] ^= other.words[ k ];
+
+	// the top bits may cancel only if other has at least our degree
+	if( degree <= other.degree )
+		degree = find_degree( );
+
+	return *this;
+}
+
+
+template< unsigned int N >
+f2poly_fixed<N>& f2poly_fixed<N>::operator+=( const uint64_t &a )
+{
+	words[ 0 ] ^= a;
+	if( degree < WORDLENGTH )
+		degree = topbit( words[ 0 ] );
+
+	return *this;
+}
+
+
+// multiply by low degree polynomial m; the caller has made sure that
+// degree + deg m < 64*N
+template< unsigned int N >
+f2poly_fixed<N>& f2poly_fixed<N>::operator*=( const uint64_t &m )
+{
+	uint64_t carryover = 0;
+
+	for( unsigned int k = 0; k < N; k++ )
+	{
+		uint64_t hi;
+		uint64_t lo = mulword( words[ k ], m, &hi );
+
+		words[ k ] = lo ^ carryover;
+		carryover = hi;
+	}
+
+	degree = m ? degree + topbit( m ) : 0;
+
+	return *this;
+}
+
+
+template< unsigned int N >
+template< class W >
+f2poly_fixed<N>& f2poly_fixed<N>::mul_by( const f2poly_mword_t &m )
+{
+	uint64_t carryover = 0;
+
+	for( unsigned int k = 0; k < N; k++ )
+	{
+		uint64_t hi;
+		uint64_t lo = W::mul( words[ k ], m, &hi );
+
+		words[ k ] = lo ^ carryover;
+		carryover = hi;
+	}
+
+	degree = m.m ? degree + topbit( m.m ) : 0;
+
+	return *this;
+}
+
+
+template< unsigned int N >
+f2poly_fixed<N>& f2poly_fixed<N>::operator+=( const f2poly_t &a )
+{
+	for( unsigned int k = 0; k < N && k < a.size( ); k++ )
+		words[ k ] ^= a.word( k );
+
+	if( degree <= a.degree )
+		degree = find_degree( );
+
+	return *this;
+}
+
+
+// schoolbook product, one word of m at a time
+template< unsigned int N >
+f2poly_fixed<N>& f2poly_fixed<N>::operator*=( const f2poly_t &m )
+{
+	if( m.size( ) == 1 )
+		return *this *= m.word( 0 );
+
+	uint64_t r[ N ];
+	for( unsigned int k = 0; k < N; k++ )
+		r[ k ] = 0;
+
+	for( unsigned int j = 0; j < N && j < m.size( ); j++ )
+	{
+		uint64_t mj = m.word( j );
+		uint64_t carryover = 0;
+
+		for( unsigned int k = 0; k + j < N; k++ )
+		{
+			uint64_t hi;
+			r[ k + j ] ^= mulword( words[ k ], mj, &hi ) ^ carryover;
+			carryover = hi;
+		}
+	}
+
+	for( unsigned int k = 0; k < N; k++ )
+		words[ k ] = r[ k ];
+	degree += m.degree;
+
+	return *this;
+}
+
+
+// print array as list of words in binary form (little-endian)
+template< unsigned int N >
+void f2poly_fixed<N>::print( ) const
+{
+	for( unsigned int k = 0; k <= degree; k++ )
+	{
+		if( k && k % WORDLENGTH == 0 ) printf( " . " );
+		else if( k && k % 4 == 0 ) printf( " " );
+		printf( "%i", checkbit( k ) );
+	}
+}
+
+
+inline void f2poly_fixed< 1 >::print( ) const
+{
+	for( unsigned int k = 0; k <= degree; k++ )
+	{
+		if( k && k % 4 == 0 ) printf( " " );
+		printf( "%i", checkbit( k ) );
+	}
+}
+
+
+template< unsigned int N >
+void f2poly_fixed<N>::printhex( ) const
+{
+	printf( "%#lx", words[ 0 ] );
+	for( unsigned int i = 1; i < size( ); i++ )
+		printf( ".%#lx", words[ i ] );
+}
+
+
+template< unsigned int N >
+void f2poly_fixed<N>::printdec( ) const
+{
+	printf( "%lu", words[ 0 ] );
+	for( unsigned int i = 1; i < size( ); i++ )
+		printf( ".%lu", words[ i ] );
+}
+
+
+
+
+
+#endif
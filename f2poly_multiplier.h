@@ -0,0 +1,115 @@
+/* f2poly_multiplier
+ *
+ * Defines a class template f2poly_multiplier_t<P>: a fixed polynomial m,
+ * together with the kernels used to multiply polynomials of type P by it
+ * (P is f2poly_t or one of the f2poly_fixed<N>). The sequence classes
+ * multiply by the same m on every step, so they build one of these when
+ * they are constructed, and the kernels are picked then, from the shape
+ * of m:
+ *
+ *   monomial, binomial, trinomial: m has 1, 2 or 3 terms, and f*m is just
+ *       that many shifted copies of f added together
+ *   clmul: any other m of one word, on a CPU with carry-less multiply
+ *   table: otherwise, m with at least TABLE_MIN_TERMS terms; the words of
+ *       f are multiplied 4 bits at a time by table lookup
+ *   bitloop: otherwise, one shifted copy of f for each term of m
+ *   wide: m has more than one word (f2poly_t::operator*=)
+ *
+ */
+
+
+#ifndef F2POLY_MULTIPLIER_H
+#define F2POLY_MULTIPLIER_H
+
+#include "f2poly.h"
+#include "f2poly_fixed.h"
+#include <cstdint>
+
+
+// below this many terms, one pass per term beats 16 table lookups
+#define TABLE_MIN_TERMS 12
+
+
+// the kernels, in the order they are tried
+enum f2poly_mkernel_t { MKERNEL_WIDE, MKERNEL_MONOMIAL, MKERNEL_BINOMIAL,
+	MKERNEL_TRINOMIAL, MKERNEL_CLMUL, MKERNEL_TABLE, MKERNEL_BITLOOP };
+
+
+template< class P >
+class f2poly_multiplier_t
+{
+	private:
+		f2poly_t m;
+		f2poly_mword_t mw;			// m, if it fits in a word
+		f2poly_mkernel_t kernel;	// picked by the constructor
+
+	public:
+		f2poly_multiplier_t( const f2poly_t &a = f2poly_t( ) );
+
+		const f2poly_t& poly( ) const { return m; }
+		const f2poly_mword_t& mword( ) const { return mw; }	// (if m fits in a word)
+		unsigned int degree( ) const { return m.degree; }
+		const char *kernel_name( ) const;
+
+		// f *= m
+		void multiply( P &f ) const
+		{
+			switch( kernel )
+			{
+				case MKERNEL_WIDE:		f *= m; break;
+				case MKERNEL_MONOMIAL:	f.template mul_by< f2poly_mulword_sparse_t<1> >( mw ); break;
+				case MKERNEL_BINOMIAL:	f.template mul_by< f2poly_mulword_sparse_t<2> >( mw ); break;
+				case MKERNEL_TRINOMIAL:	f.template mul_by< f2poly_mulword_sparse_t<3> >( mw ); break;
+				case MKERNEL_CLMUL:		f.template mul_by< f2poly_mulword_clmul_t >( mw ); break;
+				case MKERNEL_TABLE:		f.template mul_by< f2poly_mulword_table_t >( mw ); break;
+				default:				f.template mul_by< f2poly_mulword_loop_t >( mw ); break;
+			}
+		}
+
+		// f = ( f*m + 1 ) / t, for odd f
+		void mxplus1( P &f ) const
+		{
+			switch( kernel )
+			{
+				case MKERNEL_WIDE:		f *= m; f += 1; f.divide( ); break;
+				case MKERNEL_MONOMIAL:	f.template mxplus1_by< f2poly_mulword_sparse_t<1> >( mw ); break;
+				case MKERNEL_BINOMIAL:	f.template mxplus1_by< f2poly_mulword_sparse_t<2> >( mw ); break;
+				case MKERNEL_TRINOMIAL:	f.template mxplus1_by< f2poly_mulword_sparse_t<3> >( mw ); break;
+				case MKERNEL_CLMUL:		f.template mxplus1_by< f2poly_mulword_clmul_t >( mw ); break;
+				case MKERNEL_TABLE:		f.template mxplus1_by< f2poly_mulword_table_t >( mw ); break;
+				default:				f.template mxplus1_by< f2poly_mulword_loop_t >( mw ); break;
+			}
+		}
+};
+
+
+template< class P >
+f2poly_multiplier_t<P>::f2poly_multiplier_t( const f2poly_t &a ) : m( a ), mw( a.word( 0 ) )
+{
+	if( m.size( ) > 1 )
+		kernel = MKERNEL_WIDE;
+	else if( f2poly_has_clmul( ) && P::max_degree == f2poly_t::max_degree )
+		kernel = MKERNEL_CLMUL;
+	else if( mw.terms >= 1 && mw.terms <= 3 )
+		kernel = f2poly_mkernel_t( MKERNEL_MONOMIAL + mw.terms - 1 );
+	else if( f2poly_has_clmul( ) )
+		kernel = MKERNEL_CLMUL;
+	else if( mw.terms >= TABLE_MIN_TERMS )
+		kernel = MKERNEL_TABLE;
+	else
+		kernel = MKERNEL_BITLOOP;
+}
+
+
+template< class P >
+const char *f2poly_multiplier_t<P>::kernel_name( ) const
+{
+	static const char *names[ ] = { "wide", "monomial", "binomial",
+		"trinomial", "clmul", "table", "bitloop" };
+
+	return names[ kernel ];
+}
+
+
+
+#endif
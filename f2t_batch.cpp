@@ -0,0 +1,384 @@
+#include "f2t_batch.h"
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+
+// Rounds of one step for every lane, until some lane which has a start
+// has to stop: Brent's algorithm would stop there (the hare is 1, or equal
+// to the tortoise, or the timeout is reached), or the next step may not
+// fit. Returns as soon as that happens, with that lane not stepped yet.
+//
+// Everything is done for all L lanes, with the choices made by masks, so
+// that the compiler turns each loop over the lanes into a few vector
+// instructions of the kernel's width. The product h*m is built from the
+// shifts of h by the exponents of m.
+template< unsigned int N, unsigned int L >
+static inline __attribute__(( always_inline )) bool f2t_batch_rounds_body( f2t_batch_lanes_t< N > &s, const f2t_batch_params_t &p )
+{
+	while( 1 )
+	{
+		uint64_t stop = 0;
+		for( unsigned int j = 0; j < L; j++ )
+		{
+			uint64_t one = s.hare[ 0 ][ j ] ^ 1, diff = 0;
+			for( unsigned int k = 0; k < N; k++ )
+			{
+				if( k )
+					one |= s.hare[ k ][ j ];
+				diff |= s.hare[ k ][ j ] ^ s.tortoise[ k ][ j ];
+			}
+
+			uint64_t c = ( s.count[ j ] >= p.timeout ) | ( one == 0 ) | ( diff == 0 )
+				| ( ( s.hare[ N - 1 ][ j ] & p.overflow ) != 0 );
+			stop |= s.live[ j ] & -c;
+		}
+
+		if( stop )
+			return true;
+
+		uint64_t prod[ N ][ L ];
+		for( unsigned int k = 0; k < N; k++ )
+			for( unsigned int j = 0; j < L; j++ )
+				prod[ k ][ j ] = 0;
+
+		for( unsigned int b = 0; b < p.nshifts; b++ )
+		{
+			unsigned int e = p.shifts[ b ];
+			for( unsigned int j = 0; j < L; j++ )
+			{
+				prod[ 0 ][ j ] ^= s.hare[ 0 ][ j ] << e;
+				for( unsigned int k = 1; k < N; k++ )
+					prod[ k ][ j ] ^= ( s.hare[ k ][ j ] << e ) | ( s.hare[ k - 1 ][ j ] >> 1 >> ( WORDLENGTH - 1 - e ) );
+			}
+		}
+
+		for( unsigned int j = 0; j < L; j++ )
+		{
+			// should we advance i to the next power of 2?
+			uint64_t power = -(uint64_t) ( s.i[ j ] == s.lambda[ j ] );
+			for( unsigned int k = 0; k < N; k++ )
+				s.tortoise[ k ][ j ] = ( s.hare[ k ][ j ] & power ) | ( s.tortoise[ k ][ j ] & ~power );
+			s.i[ j ] = ( ( s.i[ j ] << 1 ) & power ) | ( s.i[ j ] & ~power );
+			s.lambda[ j ] &= ~power;
+
+			// the first term with degree < deg0 (h < t^deg0, from the top
+			// word down)
+			uint64_t less = 0, same = 1;
+			for( unsigned int k = N; k-- > 0; )
+			{
+				less |= same & ( s.hare[ k ][ j ] < s.below[ k ][ j ] );
+				same &= s.hare[ k ][ j ] == s.below[ k ][ j ];
+			}
+			uint64_t first = -( less & ( s.sigma[ j ] == 0 ) );
+			s.sigma[ j ] = ( s.count[ j ] & first ) | ( s.sigma[ j ] & ~first );
+
+			// odd lanes take ( h*m + 1 )/t, even ones h/t
+			uint64_t odd = -( s.hare[ 0 ][ j ] & 1 );
+			uint64_t x[ N ];
+			for( unsigned int k = 0; k < N; k++ )
+				x[ k ] = ( prod[ k ][ j ] & odd ) | ( s.hare[ k ][ j ] & ~odd );
+			x[ 0 ] ^= odd & 1;
+
+			for( unsigned int k = 0; k + 1 < N; k++ )
+				s.hare[ k ][ j ] = ( x[ k ] >> 1 ) | ( x[ k + 1 ] << ( WORDLENGTH - 1 ) );
+			s.hare[ N - 1 ][ j ] = x[ N - 1 ] >> 1;
+
+			s.lambda[ j ]++;
+			s.count[ j ]++;
+		}
+	}
+}
+
+
+template< unsigned int N >
+static bool f2t_batch_rounds_generic( f2t_batch_lanes_t< N > &s, const f2t_batch_params_t &p )
+{
+	return f2t_batch_rounds_body< N, 4 >( s, p );
+}
+
+
+#if defined( __x86_64__ )
+
+template< unsigned int N >
+__attribute__(( target( "avx2" ) ))
+static bool f2t_batch_rounds_avx2( f2t_batch_lanes_t< N > &s, const f2t_batch_params_t &p )
+{
+	return f2t_batch_rounds_body< N, 4 >( s, p );
+}
+
+
+template< unsigned int N >
+__attribute__(( target( "avx512f" ) ))
+static bool f2t_batch_rounds_avx512( f2t_batch_lanes_t< N > &s, const f2t_batch_params_t &p )
+{
+	return f2t_batch_rounds_body< N, 8 >( s, p );
+}
+
+#endif
+
+
+
+// the same step for one lane's words, on their own
+static void f2t_batch_step( uint64_t *h, unsigned int n, const f2t_batch_params_t &p )
+{
+	if( h[ 0 ] & 1 )
+	{
+		uint64_t x[ 2 ] = { 0, 0 };
+		for( unsigned int b = 0; b < p.nshifts; b++ )
+		{
+			unsigned int e = p.shifts[ b ];
+			x[ 0 ] ^= h[ 0 ] << e;
+			if( n > 1 )
+				x[ 1 ] ^= ( h[ 1 ] << e ) | ( h[ 0 ] >> 1 >> ( WORDLENGTH - 1 - e ) );
+		}
+		h[ 0 ] = x[ 0 ] ^ 1;
+		if( n > 1 )
+			h[ 1 ] = x[ 1 ];
+	}
+
+	h[ 0 ] >>= 1;
+	if( n > 1 )
+	{
+		h[ 0 ] |= h[ 1 ] << ( WORDLENGTH - 1 );
+		h[ 1 ] >>= 1;
+	}
+}
+
+
+// the degree of the polynomial in lane j of w
+template< unsigned int N >
+static unsigned int f2t_batch_degree( const uint64_t ( *w )[ F2T_BATCH_LANES_MAX ], unsigned int j )
+{
+	for( unsigned int k = N; k-- > 1; )
+		if( w[ k ][ j ] )
+			return WORDLENGTH * k + 63 - __builtin_clzll( w[ k ][ j ] );
+
+	return w[ 0 ][ j ] ? 63 - __builtin_clzll( w[ 0 ][ j ] ) : 0;
+}
+
+
+// the polynomial in lane j of w (up to its degree), as x at step count
+template< unsigned int N, class S >
+static void f2t_batch_sequence( const uint64_t ( *w )[ F2T_BATCH_LANES_MAX ], unsigned int j, unsigned int count, S &x )
+{
+	std::vector< uint64_t > a( f2t_batch_degree< N >( w, j ) / WORDLENGTH + 1 );
+	for( unsigned int k = 0; k < a.size( ); k++ )
+		a[ k ] = w[ k ][ j ];
+
+	x.setpoly( a );
+	x.set_count( count );
+}
+
+
+
+f2t_batch_t::f2t_batch_t( const f2poly_t &m, unsigned int l, unsigned int k, const char *want )
+	: proto( m ), l( l ), finished( 0 ), outgrown( 0 )
+{
+	proto.set_jump( k );
+
+	uint64_t mw = m.word( 0 );
+	params.nshifts = 0;
+	for( unsigned int e = 0; e < WORDLENGTH; e++ )
+		if( mw >> e & 1 )
+			params.shifts[ params.nshifts++ ] = e;
+
+	// a lane has to stop before its top word gets within deg m of the top
+	params.overflow = m.degree ? ~uint64_t( 0 ) << ( WORDLENGTH - m.degree ) : 0;
+	params.timeout = 0;
+
+	lanes = 4;
+	name = "generic";
+	rounds1 = f2t_batch_rounds_generic< 1 >;
+	rounds2 = f2t_batch_rounds_generic< 2 >;
+
+#if defined( __x86_64__ )
+	__builtin_cpu_init( );
+	bool has_avx2 = __builtin_cpu_supports( "avx2" );
+	bool has_avx512 = __builtin_cpu_supports( "avx512f" );
+
+	if( want != NULL && !strcmp( want, "generic" ) )
+		has_avx2 = has_avx512 = false;
+	else if( want != NULL && !strcmp( want, "avx2" ) )
+		has_avx512 = false;
+
+	if( has_avx512 )
+	{
+		lanes = 8;
+		name = "avx512";
+		rounds1 = f2t_batch_rounds_avx512< 1 >;
+		rounds2 = f2t_batch_rounds_avx512< 2 >;
+	}
+	else if( has_avx2 )
+	{
+		name = "avx2";
+		rounds1 = f2t_batch_rounds_avx2< 1 >;
+		rounds2 = f2t_batch_rounds_avx2< 2 >;
+	}
+#else
+	(void) want;
+#endif
+}
+
+
+void f2t_batch_t::run( const std::vector< uint64_t > &starts, unsigned int timeout, bool save, std::vector< f2t_batch_result_t > &results, std::vector< std::pair< unsigned int, f2t_brent_state_t > > &states )
+{
+	if( l == 1 )
+		run_as< 1 >( starts, timeout, save, results, states, rounds1 );
+	else
+		run_as< 2 >( starts, timeout, save, results, states, rounds2 );
+}
+
+
+template< unsigned int N >
+void f2t_batch_t::run_as( const std::vector< uint64_t > &starts, unsigned int timeout, bool save, std::vector< f2t_batch_result_t > &results, std::vector< std::pair< unsigned int, f2t_brent_state_t > > &states, bool ( *rounds )( f2t_batch_lanes_t< N > &, const f2t_batch_params_t & ) )
+{
+	typedef f2t_sequence_base_t< f2poly_fixed< N > > S;
+
+	results.resize( starts.size( ) );
+	params.timeout = timeout;
+
+	f2t_batch_lanes_t< N > s;
+	unsigned int index[ F2T_BATCH_LANES_MAX ];		// of the start in each lane
+	unsigned int deg0[ F2T_BATCH_LANES_MAX ];
+	unsigned int next = 0, busy = 0;
+
+	memset( &s, 0, sizeof( s ) );
+
+	// put the next start which fits in lane j, with the hare one step
+	// ahead, as at the beginning of Brent's algorithm; if there are none
+	// left, the lane stays empty
+	auto fill = [ & ]( unsigned int j )
+	{
+		s.live[ j ] = 0;
+		while( next < starts.size( ) )
+		{
+			unsigned int k = next++;
+			uint64_t w[ 2 ] = { starts[ k ], l > 1 ? 1u : 0u };
+
+			unsigned int d = l > 1 ? WORDLENGTH : 63 - __builtin_clzll( w[ 0 ] | 1 );
+			if( ( w[ N - 1 ] & params.overflow ) )
+			{
+				results[ k ].status = BATCH_SKIPPED;
+				continue;
+			}
+
+			for( unsigned int e = 0; e < N; e++ )
+			{
+				s.tortoise[ e ][ j ] = w[ e ];
+				s.below[ e ][ j ] = d && e == d / WORDLENGTH ? uint64_t( 1 ) << ( d % WORDLENGTH ) : 0;
+			}
+			f2t_batch_step( w, N, params );
+			for( unsigned int e = 0; e < N; e++ )
+				s.hare[ e ][ j ] = w[ e ];
+
+			s.count[ j ] = 1;
+			s.i[ j ] = 1;
+			s.lambda[ j ] = 1;
+			s.sigma[ j ] = 0;
+			s.live[ j ] = ~uint64_t( 0 );
+			index[ j ] = k;
+			deg0[ j ] = d;
+			return;
+		}
+		busy--;
+	};
+
+	for( unsigned int j = 0; j < lanes; j++ )
+	{
+		busy++;
+		fill( j );
+	}
+
+	S x( proto ), y( proto );
+
+	while( busy )
+	{
+		rounds( s, params );
+
+		// deal with the lanes which stopped, in the order Brent's
+		// algorithm looks at why it stopped
+		for( unsigned int j = 0; j < lanes; j++ )
+		{
+			if( !s.live[ j ] )
+				continue;
+
+			bool one = s.hare[ 0 ][ j ] == 1, equal = true;
+			for( unsigned int e = 0; e < N; e++ )
+			{
+				if( e )
+					one = one && !s.hare[ e ][ j ];
+				equal = equal && s.hare[ e ][ j ] == s.tortoise[ e ][ j ];
+			}
+			bool over = s.count[ j ] >= timeout;
+
+			if( !one && !over && !equal && !( s.hare[ N - 1 ][ j ] & params.overflow ) )
+				continue;
+
+			f2t_batch_result_t &r = results[ index[ j ] ];
+			r.d = 0;
+			r.mu = 0;
+			r.lambda = 0;
+			r.sigma = s.sigma[ j ];
+
+			if( one )
+			{
+				// return mu = time to 1, lambda = 0
+				r.status = BATCH_DONE;
+				r.mu = s.count[ j ];
+			}
+			else if( over )
+			{
+				r.status = BATCH_TIMEOUT;
+				r.d = f2t_batch_degree< N >( s.hare, j );
+			}
+			else if( equal )
+			{
+				// lambda is the period; go over the trajectory again with
+				// the hare lambda steps ahead to find mu
+				r.status = BATCH_DONE;
+				r.lambda = s.lambda[ j ];
+
+				x.setpoly( l, starts[ index[ j ] ] );
+				y = x;
+				for( unsigned int k = 0; k < r.lambda; k++ )
+					y.step( );
+				while( x != y )
+				{
+					x.step( );
+					y.step( );
+				}
+				r.mu = x.count( );
+			}
+			else
+				r.status = BATCH_OUTGROWN;
+
+			if( r.status == BATCH_OUTGROWN || ( r.status == BATCH_TIMEOUT && save ) )
+			{
+				states.push_back( std::make_pair( index[ j ], f2t_brent_state_t( ) ) );
+				f2t_brent_state_t &state = states.back( ).second;
+
+				state.f = proto;
+				state.f.setpoly( l, starts[ index[ j ] ] );
+				state.tortoise = proto;
+				f2t_batch_sequence< N >( s.tortoise, j, s.count[ j ] - s.lambda[ j ], state.tortoise );
+				state.hare = proto;
+				f2t_batch_sequence< N >( s.hare, j, s.count[ j ], state.hare );
+				state.i = s.i[ j ];
+				state.deg0 = deg0[ j ];
+				state.lambda = s.lambda[ j ];
+				state.sigma = s.sigma[ j ];
+				state.maxdegree = S::poly_type::max_degree;
+			}
+
+			if( r.status == BATCH_OUTGROWN )
+				outgrown++;
+			else
+				finished++;
+
+			fill( j );
+		}
+	}
+}
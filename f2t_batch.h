@@ -0,0 +1,123 @@
+/* f2t_batch_t
+ *
+ * Brent's algorithm on several small trajectories at once. Starts with one
+ * or two words (l = 1 or 2, m in one word) are kept in lanes, and every
+ * lane takes one step of the map per round, in lockstep: the words of the
+ * tortoises and hares are stored lane by lane (word k of every lane, then
+ * word k+1, ...), so that each round is a few vector instructions for all
+ * of them, with the odd and even steps, the powers of 2 and sigma picked
+ * per lane by masks. The lanes are 4 words wide with AVX2 and 8 with
+ * AVX-512 (whichever the CPU has, see the constructor).
+ *
+ * As soon as a lane has to stop (it reached 1, met the tortoise, timed out
+ * or is about to outgrow its words), the round loop returns, the lane is
+ * dealt with on its own and gets the next start. mu is then found by going
+ * over the trajectory again from the start. None of the other tricks of the
+ * cycle search (jumps, distinguished points, the catalogue, the table) are
+ * used in the lanes; a trajectory which gets too big for them is handed
+ * back, with where Brent's algorithm had got to, to be carried on by
+ * f2t_resume, which does use them. The outcome is the same either way.
+ *
+ */
+
+
+#ifndef F2T_BATCH_H
+#define F2T_BATCH_H
+
+#include "f2t_findcycles.h"
+#include "f2t_sequence.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// most lanes a kernel uses
+#define F2T_BATCH_LANES_MAX 8
+
+
+enum f2t_batch_status_t
+{
+	BATCH_DONE,			// mu, lambda and sigma are known
+	BATCH_TIMEOUT,		// d is the degree where it timed out
+	BATCH_OUTGROWN,		// got too big for the lanes; carry on with f2t_resume
+	BATCH_SKIPPED		// too big for the lanes to begin with
+};
+
+struct f2t_batch_result_t
+{
+	f2t_batch_status_t status;
+	unsigned int d, mu, lambda, sigma;
+};
+
+
+// the words of all the lanes, word k of lane j in [ k ][ j ]
+template< unsigned int N >
+struct f2t_batch_lanes_t
+{
+	alignas( 64 ) uint64_t tortoise[ N ][ F2T_BATCH_LANES_MAX ];
+	alignas( 64 ) uint64_t hare[ N ][ F2T_BATCH_LANES_MAX ];
+	alignas( 64 ) uint64_t below[ N ][ F2T_BATCH_LANES_MAX ];	// t^deg0
+	alignas( 64 ) uint64_t count[ F2T_BATCH_LANES_MAX ];		// of the hare
+	alignas( 64 ) uint64_t i[ F2T_BATCH_LANES_MAX ];			// power of 2
+	alignas( 64 ) uint64_t lambda[ F2T_BATCH_LANES_MAX ];
+	alignas( 64 ) uint64_t sigma[ F2T_BATCH_LANES_MAX ];
+	alignas( 64 ) uint64_t live[ F2T_BATCH_LANES_MAX ];		// all 1s if the lane has a start
+};
+
+// what the rounds need to know about m and the timeout
+struct f2t_batch_params_t
+{
+	unsigned int shifts[ WORDLENGTH ];	// the exponents of the terms of m
+	unsigned int nshifts;
+	uint64_t overflow;		// top word bits which the next step may push out
+	uint64_t timeout;
+};
+
+
+class f2t_batch_t
+{
+	public:
+		typedef bool ( *rounds1_t )( f2t_batch_lanes_t< 1 > &s, const f2t_batch_params_t &p );
+		typedef bool ( *rounds2_t )( f2t_batch_lanes_t< 2 > &s, const f2t_batch_params_t &p );
+
+	private:
+		f2t_sequence_t proto;		// m, and the jumps, for the states handed back
+		unsigned int l;
+		f2t_batch_params_t params;
+
+		unsigned int lanes;
+		const char *name;
+		rounds1_t rounds1;
+		rounds2_t rounds2;
+
+		template< unsigned int N >
+		void run_as( const std::vector< uint64_t > &starts, unsigned int timeout, bool save, std::vector< f2t_batch_result_t > &results, std::vector< std::pair< unsigned int, f2t_brent_state_t > > &states, bool ( *rounds )( f2t_batch_lanes_t< N > &, const f2t_batch_params_t & ) );
+
+	public:
+		unsigned int finished;		// trajectories done in the lanes
+		unsigned int outgrown;		// and handed back
+
+		// for the starts with l words and multiplier m (the states handed
+		// back use k-step jumps). want is "generic", "avx2" or "avx512" to
+		// pick a kernel (if the CPU has it), or NULL for the best one
+		f2t_batch_t( const f2poly_t &m, unsigned int l, unsigned int k, const char *want );
+
+		// whether there is a batch engine for these starts and m
+		static bool supported( const f2poly_t &m, unsigned int l ) { return l >= 1 && l <= 2 && m.size( ) == 1; }
+
+		const char *kernel_name( ) const { return name; }
+		unsigned int lane_count( ) const { return lanes; }
+
+		// Run Brent's algorithm up to timeout on the trajectories from the
+		// polynomials with l words and bottom words starts[ k ], as
+		// f2t_findperiod would, with the outcome in results[ k ]. Those
+		// which outgrow the lanes, and those which time out if save is set,
+		// are listed in states with where they got to (see f2t_resume);
+		// the skipped ones are left to the caller.
+		void run( const std::vector< uint64_t > &starts, unsigned int timeout, bool save, std::vector< f2t_batch_result_t > &results, std::vector< std::pair< unsigned int, f2t_brent_state_t > > &states );
+};
+
+
+
+
+#endif
@@ -2,38 +2,297 @@
 #include "f2t_findcycles.h"
 #include <cstdio>
 #include <cstdint>
+#include <vector>
 
 
 
+// Can the hare take k steps at once (see f2t_jump_table_t) without passing
+// anything the Brent loop has to stop at? The jump must not reach the
+// timeout or the next power of 2 before its last step (left is the number
+// of steps to the next power of 2), and none of the terms it skips may be
+// 1 or equal to the tortoise, or (with visited) have the degree of a start
+// in the block. If sigma is still 0 and one of those terms is the first
+// with degree < deg0, sigma is set here.
+//
+// While the degree is at least k the degrees of the skipped terms are
+// known exactly from the parities (the top of f*m^a can't cancel), so
+// none of them is 1. The hare can only meet the tortoise at term j if it
+// has the same degree there and its parities from j on are the tortoise's.
+template< class S >
+static bool f2t_can_jump( S &tortoise, S &hare, unsigned int left, unsigned int deg0, unsigned int timeout, unsigned int *sigma, const f2t_visited_t *visited )
+{
+	unsigned int k = hare.jump_steps( );
+	
+	if( !k || hare.degree( ) < k || k > left || k > timeout - hare.count( ) || !hare.jump_fits( ) )
+		return false;
+	
+	const f2t_jump_entry_t &e = hare.jump_entry( );
+	const f2t_jump_entry_t &et = tortoise.jump_entry( );
+	unsigned int low = 0;
+	
+	for( unsigned int j = 1; j < k; j++ )
+	{
+		unsigned int d = hare.jump_degree( e, j );
+		
+		if( d == tortoise.degree( ) && !( ( ( e.parities >> j ) ^ et.parities ) & ( ( 1u << ( k - j ) ) - 1 ) ) )
+			return false;
+		
+		if( visited && visited->start_degree( d ) )
+			return false;
+		
+		if( !*sigma && !low && d < deg0 )
+			low = j;
+	}
+	
+	if( low )
+		*sigma = hare.count( ) + low;
+	
+	return true;
+}
+
+
+// the same for the tortoise and hare stepping together in the search for
+// mu: they can't be equal at any term they skip
+template< class S >
+static bool f2t_can_jump_together( S &tortoise, S &hare )
+{
+	unsigned int k = hare.jump_steps( );
+	
+	if( !k || hare.degree( ) < k || tortoise.degree( ) < k || !hare.jump_fits( ) || !tortoise.jump_fits( ) )
+		return false;
+	
+	const f2t_jump_entry_t &e = hare.jump_entry( );
+	const f2t_jump_entry_t &et = tortoise.jump_entry( );
+	
+	for( unsigned int j = 1; j < k; j++ )
+		if( hare.jump_degree( e, j ) == tortoise.jump_degree( et, j ) && !( ( e.parities ^ et.parities ) >> j ) )
+			return false;
+	
+	return true;
+}
+
+
+// take n steps, k at a time where they fit
+template< class S >
+static void f2t_advance( S &x, unsigned int n )
+{
+	unsigned int k = x.jump_steps( );
+	for( unsigned int j = 0; j < n; )
+	{
+		if( k && j + k <= n && x.jump_fits( ) )
+		{
+			x.step_k( );
+			j += k;
+		}
+		else
+		{
+			x.step( );
+			j++;
+		}
+	}
+}
+
+
+// Once lambda is known, find mu: start the tortoise at a term which comes
+// no later than mu, and the hare lambda steps ahead, then step both
+// forward together until they agree. All the terms involved have to fit
+// in S.
+template< class S >
+static unsigned int f2t_find_mu( S tortoise, unsigned int lambda )
+{
+	S hare = tortoise;
+	
+	// set the tortoise and hare (lambda) steps apart
+	f2t_advance( hare, lambda );
+	
+	// now iterate until they're equal
+	while( tortoise != hare )
+	{	
+		if( f2t_can_jump_together( tortoise, hare ) )
+		{
+			tortoise.step_k( );
+			hare.step_k( );
+			continue;
+		}
+		
+		tortoise.step( );
+		hare.step( );
+	}
+	
+	return tortoise.count( );
+}
+
+
+// The latest of the checkpoints (earlier tortoise positions, in order)
+// which comes before the cycle, or f if there is none, to start the search
+// for mu from. A checkpoint is in the cycle if it comes back after lambda
+// steps, and once one is, so are all the later ones, so this is a binary
+// search. Each test costs lambda steps, and saves twice the count of the
+// checkpoint in the search for mu, so the ones too early to pay for that
+// are left out.
+template< class S >
+static S f2t_mu_start( const f2t_sequence_t &f, std::vector< S > &checkpoints, unsigned int lambda )
+{
+	int first = 0;
+	while( first < (int) checkpoints.size( ) && 2 * (uint64_t) checkpoints[ first ].count( ) <= lambda )
+		first++;
+	
+	// checkpoints[ lo ] is before the cycle, checkpoints[ hi ] is in it
+	int lo = first - 1;
+	int hi = checkpoints.size( );
+	while( hi - lo > 1 )
+	{
+		int mid = ( lo + hi ) / 2;
+		S x = checkpoints[ mid ];
+		f2t_advance( x, lambda );
+		
+		if( x == checkpoints[ mid ] )
+			hi = mid;
+		else
+			lo = mid;
+	}
+	
+	return lo >= first ? checkpoints[ lo ] : S( f );
+}
+
+
+// The search for mu when the hare is known to be in the cycle but hasn't
+// been all the way round it yet, so the terms to come may not fit in S:
+// it runs on f2t_sequence_t instead.
+template< class S >
+static unsigned int f2t_find_mu_wide( const f2t_sequence_t &f, std::vector< S > &checkpoints, unsigned int lambda )
+{
+	std::vector< f2t_sequence_t > wide;
+	for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+		wide.push_back( f2t_sequence_t( checkpoints[ k ] ) );
+	
+	return f2t_find_mu( f2t_mu_start( f, wide, lambda ), lambda );
+}
+
+
+// the key of the term x in the catalogue and among the distinguished
+// points: its words
+template< class S >
+static void f2t_cycle_key( const S &x, std::vector< uint64_t > &key )
+{
+	x.wordvector( key );
+}
+
+
+// add the cycle of length lambda through x to the catalogue, under its
+// smallest term
+template< class S >
+static void f2t_catalogue_cycle( const S &x, unsigned int lambda, cycle_catalogue_t *catalogue )
+{
+	f2t_sequence_t y = f2t_sequence_t( x );
+	std::vector< uint64_t > hashes, key, k;
+	
+	f2t_cycle_key( y, key );
+	for( unsigned int j = 0; j < lambda; j++ )
+	{
+		hashes.push_back( y.hash( ) );
+		f2t_cycle_key( y, k );
+		if( cycle_catalogue_t::key_less( k, key ) )
+			key.swap( k );
+		
+		y.step( );
+	}
+	
+	catalogue->add( key, lambda, hashes );
+}
+
+
+// Is x in a cycle no longer than maxlength? Steps a copy on to see, and
+// returns the length of the cycle, or 0 (also if it gets to 1, where
+// Brent's algorithm stops instead). low is set to the number of
+// steps to the first term with degree < deg0 on the way, or 0. The terms
+// further on may not fit in S, so this runs on f2t_sequence_t.
+template< class S >
+static unsigned int f2t_cycle_length( const S &x, unsigned int maxlength, unsigned int deg0, unsigned int *low )
+{
+	f2t_sequence_t start = f2t_sequence_t( x );
+	f2t_sequence_t y = start;
+	*low = 0;
+	
+	for( unsigned int j = 1; j <= maxlength; j++ )
+	{
+		y.step( );
+		if( y.is_one( ) )
+			return 0;
+		
+		if( !*low && y.degree( ) < deg0 )
+			*low = j;
+		
+		if( y == start )
+			return j;
+	}
+	
+	return 0;
+}
+
+
+// keep where Brent's algorithm got to when it timed out, for f2t_resume
+template< class S >
+static void f2t_save_state( f2t_brent_state_t *state, std::vector< S > &checkpoints, S &tortoise, S &hare, unsigned int i, unsigned int lambda, unsigned int sigma )
+{
+	state->checkpoints.clear( );
+	for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+		state->checkpoints.push_back( f2t_sequence_t( checkpoints[ k ] ) );
+	
+	state->tortoise = f2t_sequence_t( tortoise );
+	state->hare = f2t_sequence_t( hare );
+	state->i = i;
+	state->lambda = lambda;
+	state->sigma = sigma;
+	state->maxdegree = S::poly_type::max_degree;
+}
+
+
 // find cycle in sequence starting at f using Brent's algorithm
 // mu is the number of iterations until it becomces periodic
 // lambda is the length of the period
 // sigma is the stopping time
 // returns 0 unless the iteration times out, in which case it
 // returns the degree where it stopped
-unsigned int f2t_findperiod( f2t_sequence_t f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+//
+// This is the part of Brent's algorithm after the first step, with the
+// tortoise and hare stored as S (an f2t_sequence_base_t). If the hare is
+// about to outgrow S, the whole state moves over to the next wider type
+// and the search carries on from there.
+//
+// Each tortoise position the hare leaves behind is kept in checkpoints,
+// so that the search for mu doesn't have to replay the whole trajectory
+// from f. The last one before the cycle is at least about half way to mu.
+//
+// If it times out and state isn't NULL, the state is saved there.
+template< class S >
+static unsigned int f2t_brent( const f2t_sequence_t &f, std::vector< S > &checkpoints, S tortoise, S hare, unsigned int i, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited, f2t_brent_state_t *state )
 {
-	f2t_sequence_t tortoise = f2t_sequence_t( f );	// tortoise
-	f2t_sequence_t hare = f2t_sequence_t( f );
-	hare.step( );									// hare	
-	
-	unsigned int i = 1;			// current power of 2
-	*lambda = 1;				// period
-	*mu = 0;					// time to begin periodic part
-	*sigma = 0;
-	unsigned int deg0 = tortoise.degree( );		// degree of initial poly
+	std::vector< uint64_t > key;	// of a distinguished point
 	
-	// until the tortoise and hare are equal (or timeout)
+	// until the tortoise and hare are equal (or timeout). Once the terms
+	// are stored as f2poly_t, this compares their fingerprints, and only
+	// goes through the words when those agree
 	while( hare.count( ) < timeout && !hare.is_one( ) && tortoise != hare )
 	{	
-		
-		//printf( "k= %6lu, ", k );
-		//if( !( k % 8 ) ) printf( "\n" );
-		
+		// promote to a wider polynomial type if the next step won't fit
+		if( !hare.fits( ) )
+		{
+			typedef typename S::wider_t W;
+			std::vector< W > wider;
+			for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+				wider.push_back( W( checkpoints[ k ] ) );
+			
+			return f2t_brent( f, wider, W( tortoise ), W( hare ), i, deg0, timeout, mu, lambda, sigma, points, catalogue, table, visited, state );
+		}
 		
 		// should we advance i to the next power of 2?
 		if( i == *lambda )
 		{
+			if( checkpoints.size( ) == BRENT_CHECKPOINTS_MAX )
+				checkpoints.erase( checkpoints.begin( ) );
+			checkpoints.push_back( tortoise );
+			
 			tortoise = hare;
 			i <<= 1;
 			*lambda = 0;
@@ -43,10 +302,103 @@ unsigned int f2t_findperiod( f2t_sequence_t f, unsigned int timeout, unsigned in
 		// update sigma
 		if( !*sigma && hare.degree( ) < deg0 )
 			*sigma = hare.count( );
+		
+		// note the starts further on in the block that the hare lands on
+		// (see f2t_visited.h)
+		if( visited )
+			visited->add( hare, hare.count( ) );
+		
+		// stop at a distinguished point which an earlier trajectory has
+		// been through (see distinguished_points.h)
+		if( points && points->is_distinguished( hare.hash( ) ) )
+		{
+			f2t_cycle_key( hare, key );
+			const distinguished_points_t::entry_t *e = points->find( hare.hash( ), key );
+			if( e && points->inherit( *e, hare.count( ), deg0, timeout, mu, lambda, sigma ) )
+			{
+				if( !*mu )
+					*mu = f2t_find_mu_wide( f, checkpoints, *lambda );
+				return 0;
+			}
+			
+			points->add( hare.hash( ), key, hare.count( ) );
+		}
+		
+		// stop once the hare is in a cycle in the catalogue: then every
+		// term from here on is one of the next lambda
+		if( catalogue && catalogue->may_contain( hare.hash( ) ) )
+		{
+			unsigned int low, length = f2t_cycle_length( hare, catalogue->max_lambda( ), deg0, &low );
+			if( length && brent_detection_step( hare.count( ), length ) < timeout )
+			{
+				if( !*sigma && low )
+					*sigma = hare.count( ) + low;
+				*lambda = length;
+				*mu = f2t_find_mu_wide( f, checkpoints, length );
+				catalogue->hits++;
+				return 0;
+			}
+			
+			// (if Brent's algorithm might time out first, carry on without
+			// looking again)
+			if( length )
+				catalogue = NULL;
+		}
+		
+		// finish from the table once the degree is down to its D (sigma
+		// has to be known by then, as it can't come from the table)
+		if( table && *sigma && hare.degree( ) <= table->degree( ) )
+		{
+			if( table->lookup( hare.bottomword( ), hare.count( ), timeout, mu, lambda ) )
+			{
+				if( !*mu )
+					*mu = f2t_find_mu_wide( f, checkpoints, *lambda );
+				table->hits++;
+				return 0;
+			}
+			
+			// (as for the catalogue)
+			if( table->in_cycle( hare.bottomword( ) ) )
+				table = NULL;
+		}
+			
+		
+		// (single word polynomials divide in one instruction anyway)
+		if( hare.parity( ) || hare.degree( ) < WORDLENGTH )
+		{
+			// k steps at once when nothing can happen on the way
+			if( f2t_can_jump( tortoise, hare, i - *lambda, deg0, timeout, sigma, visited ) )
+			{
+				hare.step_k( );
+				*lambda += hare.jump_steps( );
+				continue;
+			}
 			
+			hare.step( );				// hare steps foward
+			(*lambda)++;				// period counter
+			continue;
+		}
+		
+		// f(0) = 0, so the next steps are divisions by t until the next odd
+		// term. Take them all at once, stopping early at the first point where
+		// the loop has to look at the hare again: the timeout, the next power
+		// of 2, the first degree below deg0, the degree of the tortoise
+		// (the only place where they could meet), or each degree of a start
+		// in the block. The degree goes down by exactly 1 on each of these
+		// steps.
+		unsigned int d = hare.degree( );
+		unsigned int limit = timeout - hare.count( );
 		
-		hare.step( );				// hare steps foward
-		(*lambda)++;				// period counter
+		if( i - *lambda < limit )
+			limit = i - *lambda;
+		if( !*sigma && d - deg0 + 1 < limit )
+			limit = d - deg0 + 1;
+		if( d > tortoise.degree( ) && d - tortoise.degree( ) < limit )
+			limit = d - tortoise.degree( );
+		if( visited && visited->steps_to_start( d ) && visited->steps_to_start( d ) < limit )
+			limit = visited->steps_to_start( d );
+		
+		*lambda += hare.step_even( limit );
 	}
 	
 	
@@ -66,56 +418,305 @@ unsigned int f2t_findperiod( f2t_sequence_t f, unsigned int timeout, unsigned in
 	// if we timed out...
 	if( hare.count( ) >= timeout )
 	{
+		if( state )
+			f2t_save_state( state, checkpoints, tortoise, hare, i, *lambda, *sigma );
+		
 		*mu = 0;
 		*lambda = 0;
 		return hare.degree( );	// return the degree at which we timed out
 	}
 	
-	// now we can be sure the sequence really does become periodic
+	// now we can be sure the sequence really does become periodic, and
+	// lambda is the period. None of the terms before the hare is bigger
+	// than the ones the hare has already seen, so they all fit in S.
+	*mu = f2t_find_mu( f2t_mu_start( f, checkpoints, *lambda ), *lambda );
 	
-	// lambda is the period of the sequence. We want to find the exact
-	// point where the sequence becomes periodic.
+	// the tortoise is in the cycle
+	if( catalogue )
+		f2t_catalogue_cycle( tortoise, *lambda, catalogue );
+	return 0;
+}
+
+
+// Once x is in the cycle and lambda is known, the latest term on
+// Nivasch's stacks which comes before the cycle, or f if there is none.
+// The smallest term of each class in the cycle stays on its stack from
+// when it first comes, with only later terms of the cycle above it and
+// only terms from before the cycle under it, so going round the cycle
+// once to find those smallest terms shows where each stack enters it.
+// Terms of the cycle fit in S.
+template< class S >
+static S f2t_nivasch_mu_start( const f2t_sequence_t &f, std::vector< S > *stacks, unsigned int *sizes, S x, unsigned int lambda )
+{
+	std::vector< S > least( NIVASCH_STACKS, x );
+	bool seen[ NIVASCH_STACKS ] = { false };
+	for( unsigned int j = 0; j < lambda; j++ )
+	{
+		uint64_t h = x.hash( );
+		unsigned int c = nivasch_class( h );
+		if( !seen[ c ] || h < least[ c ].hash( ) )
+		{
+			least[ c ] = x;
+			seen[ c ] = true;
+		}
+		
+		x.step( );
+	}
 	
-	// set the tortoise at the beginning (f) and the hare lambda steps
-	// ahead. Then step both forward together one at a time until they
-	// agree
+	S *start = NULL;
+	for( unsigned int c = 0; c < NIVASCH_STACKS; c++ )
+	{
+		if( !seen[ c ] )
+			continue;
+		
+		unsigned int k = 1;
+		while( k < sizes[ c ] && stacks[ c ][ k ] != least[ c ] )
+			k++;
+		
+		if( k < sizes[ c ] && ( !start || stacks[ c ][ k - 1 ].count( ) > start->count( ) ) )
+			start = &stacks[ c ][ k - 1 ];
+	}
 	
-	tortoise = f;
-	hare = f;
+	return start ? *start : S( f );
+}
+
+
+// Nivasch's stack algorithm, after the terms up to x, with the terms split
+// into classes by hash (see cycle_detector.h). Each class has a stack
+// holding its terms in increasing order of fingerprint: each new term
+// pops the ones bigger than itself from its stack and is pushed. When a
+// term equals the top of its stack, that is the smallest term of its
+// class in the cycle, seen once around the cycle ago, which gives lambda.
+// The search for mu then starts from f2t_nivasch_mu_start.
+//
+// Every term goes on a stack, so this takes single steps: no jumps, and
+// no runs of divisions by t. A cycle is only reported if Brent's algorithm
+// would have seen it before the timeout too, so the rows agree with
+// f2t_brent except where the stacks see the cycle too late.
+//
+// The stacks have the terms stored as S and grow with x; the word arrays
+// of popped terms are kept for the next ones pushed.
+template< class S >
+static unsigned int f2t_nivasch( const f2t_sequence_t &f, std::vector< S > *stacks, unsigned int *sizes, S x, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+{
+	unsigned int again;		// the step at which x was seen before
+	while( 1 )
+	{
+		// the same checks on each term as in f2t_brent (which starts at
+		// the first step)
+		if( x.count( ) )
+		{
+			if( x.is_one( ) )
+			{
+				*mu = x.count( );
+				*lambda = 0;
+				return 0;
+			}
+			
+			if( x.count( ) >= timeout )
+			{
+				*mu = 0;
+				*lambda = 0;
+				return x.degree( );
+			}
+			
+			if( !*sigma && x.degree( ) < deg0 )
+				*sigma = x.count( );
+		}
+		
+		uint64_t h = x.hash( );
+		std::vector< S > &stack = stacks[ nivasch_class( h ) ];
+		unsigned int &size = sizes[ nivasch_class( h ) ];
+		while( size && stack[ size - 1 ].hash( ) > h )
+			size--;
+		
+		if( size && stack[ size - 1 ] == x )
+		{
+			again = stack[ size - 1 ].count( );
+			break;
+		}
+		
+		if( size == NIVASCH_STACK_MAX )
+		{
+			stack.erase( stack.begin( ) );
+			size--;
+		}
+		if( size < stack.size( ) )
+			stack[ size ] = x;
+		else
+			stack.push_back( x );
+		size++;
+		
+		// promote everything to a wider polynomial type if the next step
+		// won't fit, and carry on from there with the next term
+		if( !x.fits( ) )
+		{
+			typedef typename S::wider_t W;
+			std::vector< W > wider[ NIVASCH_STACKS ];
+			for( unsigned int c = 0; c < NIVASCH_STACKS; c++ )
+				for( unsigned int k = 0; k < sizes[ c ]; k++ )
+					wider[ c ].push_back( W( stacks[ c ][ k ] ) );
+			
+			W next = W( x );
+			next.step( );
+			return f2t_nivasch( f, wider, sizes, next, deg0, timeout, mu, lambda, sigma );
+		}
+		
+		x.step( );
+	}
 	
-	// set the tortoise and hare (lambda) steps apart
-	for( unsigned int j = 1; j <= *lambda; j++ )
-		hare.step( );
+	*lambda = x.count( ) - again;
+	S start = f2t_nivasch_mu_start( f, stacks, sizes, x, *lambda );
+	*mu = f2t_find_mu( start, *lambda );
 	
-	// now iterate until they're equal
-	while( tortoise != hare )
-	{	
-		tortoise.step( );
-		hare.step( );
+	// the search stops at once if start is in the cycle after all, which
+	// takes two terms with the same fingerprint; then go back to f
+	if( start.count( ) && *mu == start.count( ) )
+		*mu = f2t_find_mu( S( f ), *lambda );
+	
+	// Brent's algorithm would have timed out first: stop at the same term
+	if( brent_detection_step( *mu, *lambda ) >= timeout )
+	{
+		for( unsigned int k = ( timeout - x.count( ) ) % *lambda; k; k-- )
+			x.step( );
+		
+		*mu = 0;
+		*lambda = 0;
+		return x.degree( );
 	}
 	
-	*mu = tortoise.count( );
 	return 0;
 }
 
 
+// start the cycle search with f stored as S, or as the first wider type
+// which can hold it
+template< class S >
+static unsigned int f2t_findperiod_as( const f2t_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited, f2t_brent_state_t *state )
+{
+	if( f.step_degree( ) > S::poly_type::max_degree )
+		return f2t_findperiod_as< typename S::wider_t >( f, timeout, mu, lambda, sigma, detector, points, catalogue, table, visited, state );
+	
+	*mu = 0;					// time to begin periodic part
+	*sigma = 0;
+	
+	if( detector == DETECT_NIVASCH )
+	{
+		std::vector< S > stacks[ NIVASCH_STACKS ];
+		unsigned int sizes[ NIVASCH_STACKS ] = { 0 };
+		S x = S( f );
+		
+		return f2t_nivasch( f, stacks, sizes, x, x.degree( ), timeout, mu, lambda, sigma );
+	}
+	
+	S tortoise = S( f );	// tortoise
+	
+	// an earlier trajectory in the block may have been through f
+	if( visited && visited->answer( tortoise, timeout, mu, lambda, sigma ) )
+		return 0;
+	
+	S hare = S( f );
+	hare.step( );			// hare	
+	
+	*lambda = 1;				// period
+	
+	std::vector< S > checkpoints;
+	
+	// current power of 2 is 1, degree of initial poly
+	unsigned int deg0 = tortoise.degree( );
+	unsigned int d = f2t_brent( f, checkpoints, tortoise, hare, 1, deg0, timeout, mu, lambda, sigma, points, catalogue, table, visited, state );
+	
+	if( points )
+		points->finish( deg0, !d, *mu, *lambda, *sigma );
+	if( visited )
+		visited->finish( deg0, !d, *mu, *lambda, *sigma );
+	
+	if( d && state )
+	{
+		state->f = f;
+		state->deg0 = deg0;
+	}
+	
+	return d;
+}
+
 
-// This function tests one polynomial using f2t_findperiod, then outputs
-// the information in a neat row of text
-void f2t_run_and_print( f2t_sequence_t f, unsigned int timeout )
+// carry on from a saved state with the terms stored as S, or as the first
+// wider type which can hold all of them. (The search for mu goes back
+// over terms which may be bigger than the ones kept.)
+template< class S >
+static unsigned int f2t_resume_as( f2t_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited )
 {
-	unsigned int mu, lambda, sigma, d;
+	if( state.maxdegree > S::poly_type::max_degree )
+		return f2t_resume_as< typename S::wider_t >( state, timeout, mu, lambda, sigma, points, catalogue, table, visited );
 	
-	f.print( );
+	std::vector< S > checkpoints;
+	for( unsigned int k = 0; k < state.checkpoints.size( ); k++ )
+		checkpoints.push_back( S( state.checkpoints[ k ] ) );
 	
-	d = f2t_findperiod( f, timeout, &mu, &lambda, &sigma );
+	*mu = 0;
+	*lambda = state.lambda;
+	*sigma = state.sigma;
 	
+	// (this overwrites state if it times out again)
+	unsigned int d = f2t_brent( state.f, checkpoints, S( state.tortoise ), S( state.hare ), state.i, state.deg0, timeout, mu, lambda, sigma, points, catalogue, table, visited, &state );
+	
+	if( points )
+		points->finish( state.deg0, !d, *mu, *lambda, *sigma );
+	if( visited )
+		visited->finish( state.deg0, !d, *mu, *lambda, *sigma );
+	
+	return d;
+}
+
+
+// small polynomials start out in a single word and are promoted to 2, 4,
+// and then any number of words as they grow
+unsigned int f2t_findperiod( const f2t_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited, f2t_brent_state_t *state )
+{
+	return f2t_findperiod_as< f2t_sequence_base_t< f2poly_fixed<1> > >( f, timeout, mu, lambda, sigma, detector, points, catalogue, table, visited, state );
+}
+
+
+// the same for a saved state, going straight to the type it had got to
+unsigned int f2t_resume( f2t_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited )
+{
+	return f2t_resume_as< f2t_sequence_base_t< f2poly_fixed<1> > >( state, timeout, mu, lambda, sigma, points, catalogue, table, visited );
+}
+
+
+
+// the rest of a row of output, after f
+static void f2t_print_outcome( unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma )
+{
 	if( sigma ) printf( ", %8u", sigma );
 	else printf( ", %8s", "inf" );
 	
 	if( d ) printf( ", timeout(%u), d=%u\n", timeout, d );
 	else printf( ", %8u, %8u\n", mu, lambda );
+}
+
+
+// This function tests one polynomial using f2t_findperiod, then outputs
+// the information in a neat row of text
+void f2t_run_and_print( const f2t_sequence_t &f, unsigned int timeout, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2t_table_t *table, f2t_visited_t *visited )
+{
+	unsigned int mu, lambda, sigma, d;
+	
+	f.print( );
 	
+	d = f2t_findperiod( f, timeout, &mu, &lambda, &sigma, detector, points, catalogue, table, visited );
+	
+	f2t_print_outcome( timeout, d, mu, lambda, sigma );
+	
+}
+
+
+// the same row, for an outcome found some other way
+void f2t_print_row( const f2t_sequence_t &f, unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma )
+{
+	f.print( );
+	f2t_print_outcome( timeout, d, mu, lambda, sigma );
 }
 
 
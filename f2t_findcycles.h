@@ -1,20 +1,60 @@
 #ifndef F2T_FINDCYCLES_H
 #define F2T_FINDCYCLES_H
 
+#include "cycle_catalogue.h"
+#include "cycle_detector.h"
+#include "distinguished_points.h"
 #include "f2t_sequence.h"
+#include "f2t_table.h"
+#include "f2t_visited.h"
 #include <cstdint>
-
-// find cycle in sequence starting at f using Brent's algorithm
+#include <vector>
+
+
+// Where Brent's algorithm had got to on a trajectory when it timed out:
+// the start, the earlier tortoise positions kept for the search for mu,
+// the tortoise, the hare (with its step count), the power of 2, the
+// counter for lambda, and sigma so far. maxdegree is that of the widest
+// polynomial type it had to use, which holds every term so far
+struct f2t_brent_state_t
+{
+	f2t_sequence_t f;
+	std::vector< f2t_sequence_t > checkpoints;
+	f2t_sequence_t tortoise, hare;
+	unsigned int i, deg0, lambda, sigma, maxdegree;
+};
+
+// find cycle in sequence starting at f using Brent's algorithm, or the
+// one picked by detector (see cycle_detector.h). With points, Brent's
+// algorithm stops early at distinguished points that earlier trajectories
+// have been through (see distinguished_points.h), and with catalogue,
+// once it is in a cycle found before, whose new cycles it adds (see
+// cycle_catalogue.h), and with table, once the degree is low enough for
+// the table to know the outcome (see f2t_table.h). With visited, f may not
+// be run at all if an earlier start in its block went through it (see
+// f2t_visited.h). If Brent's algorithm times out and state isn't NULL,
+// where it got to is saved there.
 // mu is the number of iterations until it becomces periodic
 // lambda is the length of the period
+// sigma is the stopping time
 // returns 0 unless the iteration times out, in which case it
 // returns the degree where it stopped
-unsigned int f2t_findperiod( f2t_sequence_t f, unsigned int timeout, unsigned int *mu, unsigned int *lambda );
+unsigned int f2t_findperiod( const f2t_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector = DETECT_BRENT, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL, f2t_table_t *table = NULL, f2t_visited_t *visited = NULL, f2t_brent_state_t *state = NULL );
+
+
+// Carry on with Brent's algorithm from a saved state, up to a bigger
+// timeout: the outcome is the same as from f2t_findperiod with that
+// timeout. If it times out again, state is updated.
+unsigned int f2t_resume( f2t_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL, f2t_table_t *table = NULL, f2t_visited_t *visited = NULL );
 
 
 // This function tests one polynomial using f2t_findperiod, then outputs
 // the information in a neat row of text
-void f2t_run_and_print( f2t_sequence_t f, unsigned int timeout );
+void f2t_run_and_print( const f2t_sequence_t &f, unsigned int timeout, cycle_detector_t detector = DETECT_BRENT, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL, f2t_table_t *table = NULL, f2t_visited_t *visited = NULL );
+
+// the same row for an outcome already found (d is the degree at the
+// timeout, or 0)
+void f2t_print_row( const f2t_sequence_t &f, unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma );
 
 
 
@@ -8,44 +8,399 @@
  * 
  * Parameter for the mx+1 map is specified as an environment variable:
  * F2T_M
- * (stored in binary form, i.e. the k-th bit is the coefficient of t^k)
+ * (stored in binary form, i.e. the k-th bit is the coefficient of t^k; wide
+ * multipliers can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
  * 
- * Command line arguments: < l, bottom, n, timeout >
+ * Optionally, F2T_JUMP sets k for the k-step jump table used by the cycle
+ * search (0 for single steps only, default 12; k is capped so that m^k
+ * fits in a word)
+ * 
+ * F2T_DETECTOR picks the cycle detection algorithm, brent (the default) or
+ * nivasch (see cycle_detector.h). nivasch takes single steps and ignores
+ * F2T_JUMP and F2T_DP_BITS to F2T_BATCH below, with a warning if they are
+ * set.
+ * 
+ * F2T_DP_BITS, if set to k > 0, lets Brent's algorithm stop at terms whose
+ * hash ends in k zero bits once an earlier input in the block has been
+ * through them, and take sigma, mu and lambda from there (see
+ * distinguished_points.h). The output is the same.
+ * 
+ * F2T_CATALOGUE names a file of the cycles found so far for m, shared
+ * between runs: Brent's algorithm stops as soon as a trajectory enters one
+ * of them, and adds the new ones (see cycle_catalogue.h). The output is the
+ * same.
+ * 
+ * F2T_TABLE names a table of outcomes for all polynomials of low degree,
+ * made by f2t_main_table for the same m: Brent's algorithm then stops as
+ * soon as a trajectory gets down to its degree (see f2t_table.h). The
+ * output is the same.
+ * 
+ * F2T_VISITED, if set to 1, keeps a bitmap of the inputs in the block that
+ * earlier trajectories have been through, and takes their sigma, mu and
+ * lambda from there instead of running them (see f2t_visited.h). The output
+ * is the same.
+ * 
+ * F2T_ESCALATE, if set to s > 0, first runs every input in a chunk for at
+ * most s steps, and keeps where Brent's algorithm got to on the ones which
+ * time out. Those are then carried on from there for 2s steps, then 4s,
+ * and so on up to the timeout, so the quick inputs are all done first and
+ * no step is taken twice. The output is the same.
+ * 
+ * F2T_BATCH, if set to 1, runs Brent's algorithm on 4 or 8 inputs at once,
+ * one in each lane of the vector registers, for as long as they fit in l
+ * words (for l = 1 or 2, and m in one word; see f2t_batch.h). Set to
+ * generic, avx2 or avx512, it also picks the kernel. The output is the
+ * same.
+ * 
+ * F2T_THREADS sets the number of threads (default: one per core). The
+ * block is handed out to them in chunks, which get smaller towards the
+ * end so that the threads finish together, and the rows are printed in
+ * order as the chunks are done. The threads share the distinguished points
+ * and the bitmap of visited inputs, and each has its own view of the
+ * catalogue and the table.
+ * Command line arguments: < l, bottom, n, timeout > [ sieve, census ]
  * 		l: number of words in initial polynomial f
  * 		bottom: bottom word of initial polynomial f
  * 			( so f = t^{64*(l+1)-1} + bottom )
  * 		n: number of polynomials in block
  * 		timeout: maximum number of steps to calculate for each trajectory
+ * 		sieve: depth k of the stopping time sieve (see f2t_sieve.h), 0 for
+ * 			none. Inputs whose degree provably drops within k steps get
+ * 			their sigma from the sieve, with no cycle search ("-" for mu
+ * 			and lambda)
+ * 		census: if 1, those inputs are skipped instead, and only the
+ * 			ones which survive the sieve are listed
  * 
  */
 
 
 #include "f2t_sequence.h"
 #include "f2t_findcycles.h"
+#include "f2t_batch.h"
+#include "f2t_sieve.h"
 #include <cstdlib>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// chunk sizes: a thread takes 1/(CHUNK_SHARE * threads) of the inputs left,
+// but at least CHUNK_MIN and at most CHUNK_MAX of them
+#define CHUNK_SHARE 4
+#define CHUNK_MIN 16
+#define CHUNK_MAX 4096
+
+
+// what happened to one input
+struct outcome_t
+{
+	unsigned int d, mu, lambda, sigma;
+	bool sieved;			// sigma is from the sieve, with no cycle search
+};
+
+
+// what each thread has to itself (the sieve is only read, so it is shared)
+struct worker_t
+{
+	f2t_sequence_t f;
+	distinguished_points_t *points;		// (views of one table, and one bitmap)
+	f2t_visited_t *visited;
+	cycle_catalogue_t *catalogue;
+	f2t_table_t *table;
+	f2t_batch_t *batch;
+	
+	unsigned int eliminated;		// by the sieve
+	std::map< unsigned int, unsigned int > rounds;	// inputs which went on past each budget
+	
+	worker_t( const f2poly_t &m ) : f( m ), points( NULL ), visited( NULL ), catalogue( NULL ), table( NULL ), batch( NULL ), eliminated( 0 ) { }
+	~worker_t( ) { delete points; delete visited; delete catalogue; delete table; delete batch; }
+};
+
+
+// the block, and how far the threads have got with it
+struct block_t
+{
+	unsigned int l;
+	uint64_t bottom;			// the inputs are bottom + 1 to bottom + n
+	unsigned int n, timeout, escalate, threads;
+	cycle_detector_t detector;
+	bool census;
+	const f2t_sieve_t *sieve;
+	
+	std::mutex lock;
+	unsigned int next;			// first input not handed out yet
+	unsigned int printed;		// first input not printed yet
+	std::map< unsigned int, std::vector< outcome_t > > finished;	// chunks waiting to be printed
+};
+
+
+// run Brent's algorithm on input k of the chunk with f2t_findperiod, and
+// keep it for later if it times out before the timeout
+static void run_input( block_t &b, worker_t &w, unsigned int k, outcome_t &o, unsigned int budget, std::vector< std::pair< unsigned int, f2t_brent_state_t > > &survivors )
+{
+	f2t_brent_state_t state;
+	o.d = f2t_findperiod( w.f, budget, &o.mu, &o.lambda, &o.sigma, b.detector, w.points, w.catalogue, w.table, w.visited, budget < b.timeout ? &state : NULL );
+	
+	if( o.d && budget < b.timeout )
+		survivors.push_back( std::make_pair( k, std::move( state ) ) );
+}
+
+
+// run the inputs first to first + count - 1 of the block
+static void run_chunk( block_t &b, worker_t &w, unsigned int first, std::vector< outcome_t > &out )
+{
+	// with escalation, the first pass only goes up to the smallest budget,
+	// and the inputs which time out are kept for later
+	unsigned int budget = b.escalate && b.escalate < b.timeout ? b.escalate : b.timeout;
+	std::vector< std::pair< unsigned int, f2t_brent_state_t > > survivors;
+	
+	// (with the batch engine, the inputs are only queued for it here)
+	std::vector< uint64_t > starts;
+	std::vector< unsigned int > queued;
+	
+	for( unsigned int k = 0; k < out.size( ); k++ )
+	{
+		uint64_t bottom = b.bottom + 1 + first + k;
+		outcome_t &o = out[ k ];
+		w.f.setpoly( b.l, bottom );
+		
+		// (the sieve only applies once the degree is at least its depth)
+		o.sigma = 0;
+		if( b.sieve && w.f.degree( ) >= b.sieve->depth( ) )
+			o.sigma = b.sieve->stopping_time( bottom );
+		
+		o.sieved = o.sigma;
+		if( o.sieved )
+		{
+			w.eliminated++;
+			continue;
+		}
+		
+		if( w.batch )
+		{
+			starts.push_back( bottom );
+			queued.push_back( k );
+			continue;
+		}
+		
+		run_input( b, w, k, o, budget, survivors );
+	}
+	
+	// the lanes hand back the inputs they can't finish: those too big for
+	// them are run as usual, and those which outgrow them on the way carry
+	// on from where they got to
+	if( !starts.empty( ) )
+	{
+		std::vector< f2t_batch_result_t > results;
+		std::vector< std::pair< unsigned int, f2t_brent_state_t > > states;
+		w.batch->run( starts, budget, budget < b.timeout, results, states );
+		
+		for( unsigned int j = 0; j < results.size( ); j++ )
+		{
+			outcome_t &o = out[ queued[ j ] ];
+			o.d = results[ j ].d;
+			o.mu = results[ j ].mu;
+			o.lambda = results[ j ].lambda;
+			o.sigma = results[ j ].sigma;
+			
+			if( results[ j ].status == BATCH_SKIPPED )
+			{
+				w.f.setpoly( b.l, starts[ j ] );
+				run_input( b, w, queued[ j ], o, budget, survivors );
+			}
+		}
+		
+		for( unsigned int j = 0; j < states.size( ); j++ )
+		{
+			unsigned int k = queued[ states[ j ].first ];
+			outcome_t &o = out[ k ];
+			if( results[ states[ j ].first ].status == BATCH_OUTGROWN )
+				o.d = f2t_resume( states[ j ].second, budget, &o.mu, &o.lambda, &o.sigma, w.points, w.catalogue, w.table, w.visited );
+			
+			if( o.d && budget < b.timeout )
+				survivors.push_back( std::make_pair( k, std::move( states[ j ].second ) ) );
+		}
+	}
+	
+	// then the ones which timed out carry on from where they got to, with
+	// the budget doubling each time, until it reaches the timeout
+	while( !survivors.empty( ) )
+	{
+		w.rounds[ budget ] += survivors.size( );
+		budget = budget < b.timeout / 2 ? 2 * budget : b.timeout;
+		
+		unsigned int kept = 0;
+		for( unsigned int j = 0; j < survivors.size( ); j++ )
+		{
+			outcome_t &o = out[ survivors[ j ].first ];
+			o.d = f2t_resume( survivors[ j ].second, budget, &o.mu, &o.lambda, &o.sigma, w.points, w.catalogue, w.table, w.visited );
+			
+			if( o.d && budget < b.timeout )
+			{
+				if( kept < j )
+					survivors[ kept ] = std::move( survivors[ j ] );
+				kept++;
+			}
+		}
+		
+		survivors.resize( kept );
+	}
+}
+
+
+// print the rows for a chunk
+static void print_chunk( block_t &b, worker_t &w, unsigned int first, const std::vector< outcome_t > &out )
+{
+	for( unsigned int k = 0; k < out.size( ); k++ )
+	{
+		const outcome_t &o = out[ k ];
+		w.f.setpoly( b.l, b.bottom + 1 + first + k );
+		
+		if( !o.sieved )
+			f2t_print_row( w.f, b.timeout, o.d, o.mu, o.lambda, o.sigma );
+		else if( !b.census )
+		{
+			w.f.print( );
+			printf( ", %8u, %8s, %8s\n", o.sigma, "-", "-" );
+		}
+	}
+}
+
+
+// one thread: take chunks until there are none left. Each finished chunk
+// waits until the ones before it have been printed, and then whichever
+// thread finishes the chunk which is next prints all the ones in order
+static void findperiod_worker( block_t *b, worker_t *w )
+{
+	std::unique_lock< std::mutex > guard( b->lock );
+	
+	while( b->next < b->n )
+	{
+		unsigned int first = b->next;
+		unsigned int count = ( b->n - first ) / ( CHUNK_SHARE * b->threads );
+		if( count < CHUNK_MIN )
+			count = CHUNK_MIN;
+		if( count > CHUNK_MAX )
+			count = CHUNK_MAX;
+		if( count > b->n - first )
+			count = b->n - first;
+		b->next += count;
+		
+		guard.unlock( );
+		std::vector< outcome_t > out( count );
+		run_chunk( *b, *w, first, out );
+		guard.lock( );
+		
+		b->finished[ first ].swap( out );
+		while( !b->finished.empty( ) && b->finished.begin( )->first == b->printed )
+		{
+			print_chunk( *b, *w, b->printed, b->finished.begin( )->second );
+			b->printed += b->finished.begin( )->second.size( );
+			b->finished.erase( b->finished.begin( ) );
+		}
+		fflush( stdout );
+	}
+}
 
 
 // initialize starting polynomial with l words, all 0 except most significant (top)
 // start there, and do n consecutive polynoimals
-void findperiod_loop( uint64_t multiplier, int l, uint64_t bottom, unsigned int n, unsigned int timeout )
+void findperiod_loop( f2poly_t multiplier, block_t &b, std::vector< worker_t* > &workers, unsigned int bits )
 {
-	f2t_sequence_t f = f2t_sequence_t( multiplier );
-	f.setpoly( l, bottom );
+	f2t_sequence_t &f = workers[ 0 ]->f;
+	f.setpoly( b.l, b.bottom );
 	
-	printf( "\nusing multiplier %lu \n", multiplier );
-	printf( "calculating periods for %u consecutive inputs,\n", n );
+	printf( "\nusing multiplier " );
+	multiplier.printdec( );
+	printf( " \n" );
+	printf( "using multiply kernel %s\n", f2poly_kernel_name( ) );
+	printf( "using step kernel %s (%s beyond 4 words)\n",
+		f2t_sequence_base_t< f2poly_fixed<4> >( multiplier ).kernel_name( ), f.kernel_name( ) );
+	if( f.jump_steps( ) )
+		printf( "using %u-step jumps\n", f.jump_steps( ) );
+	printf( "using cycle detector %s\n", cycle_detector_name( b.detector ) );
+	printf( "using %u threads\n", b.threads );
+	if( workers[ 0 ]->points )
+		printf( "using distinguished points with %u zero bits\n", bits );
+	if( workers[ 0 ]->catalogue )
+		printf( "using cycle catalogue with %zu cycles\n", workers[ 0 ]->catalogue->size( ) );
+	if( workers[ 0 ]->table )
+		printf( "using table of outcomes up to degree %u\n", workers[ 0 ]->table->degree( ) );
+	if( workers[ 0 ]->visited )
+		printf( "using bitmap of visited inputs\n" );
+	if( workers[ 0 ]->batch )
+		printf( "using batch engine %s with %u lanes\n", workers[ 0 ]->batch->kernel_name( ), workers[ 0 ]->batch->lane_count( ) );
+	if( b.escalate )
+		printf( "using step budgets from %u, doubling up to the timeout\n", b.escalate );
+	if( b.sieve )
+		printf( "sieve depth %u: %.6f of the classes mod t^%u have stopping time <= %u\n",
+			b.sieve->depth( ), b.sieve->fraction( ), b.sieve->depth( ), b.sieve->depth( ) );
+	printf( "calculating periods for %u consecutive inputs,\n", b.n );
 	printf( "starting at " );
 	f.print( );
 	printf( "\n%5s, %8s, %8s, %8s\n", "f", "sigma", "mu", "lambda" );
+	fflush( stdout );
 	
-	for( unsigned int i = 0; i < n; i++ )
-	{	
-		f.setpoly( l, ++bottom );
-		
-		f2t_run_and_print( f, timeout );
+	b.next = 0;
+	b.printed = 0;
+	
+	std::vector< std::thread > threads;
+	for( unsigned int t = 1; t < b.threads; t++ )
+		threads.push_back( std::thread( findperiod_worker, &b, workers[ t ] ) );
+	findperiod_worker( &b, workers[ 0 ] );
+	for( unsigned int t = 0; t < threads.size( ); t++ )
+		threads[ t ].join( );
+	
+	// the statistics, added up over the threads
+	unsigned int eliminated = 0, answered = 0, merged = 0, hits = 0, added = 0, table_hits = 0, batched = 0, outgrown = 0;
+	std::map< unsigned int, unsigned int > rounds;
+	for( unsigned int t = 0; t < b.threads; t++ )
+	{
+		worker_t &w = *workers[ t ];
+		eliminated += w.eliminated;
+		if( w.visited )
+			answered += w.visited->answered;
+		if( w.points )
+			merged += w.points->merged;
+		if( w.catalogue )
+		{
+			hits += w.catalogue->hits;
+			added += w.catalogue->added;
+		}
+		if( w.table )
+			table_hits += w.table->hits;
+		if( w.batch )
+		{
+			batched += w.batch->finished;
+			outgrown += w.batch->outgrown;
+		}
+		for( std::map< unsigned int, unsigned int >::iterator it = w.rounds.begin( ); it != w.rounds.end( ); it++ )
+			rounds[ it->first ] += it->second;
 	}
+	
+	for( std::map< unsigned int, unsigned int >::iterator it = rounds.begin( ); it != rounds.end( ); it++ )
+		printf( "escalation: %u inputs went on past %u steps\n", it->second, it->first );
+	if( b.sieve )
+		printf( "sieve depth %u: eliminated %u of %u inputs (%.6f)\n",
+			b.sieve->depth( ), eliminated, b.n, b.n ? (double) eliminated / b.n : 0.0 );
+	if( workers[ 0 ]->points )
+		printf( "distinguished points: merged %u of %u inputs, %zu points kept\n",
+			merged, b.n, workers[ 0 ]->points->size( ) );
+	if( workers[ 0 ]->catalogue )
+		printf( "cycle catalogue: %u inputs entered known cycles, %u new cycles added\n",
+			hits, added );
+	if( workers[ 0 ]->table )
+		printf( "table: %u inputs finished from the table\n", table_hits );
+	if( workers[ 0 ]->batch )
+		printf( "batch: %u of %u inputs finished in the lanes, %u outgrew them\n", batched, b.n, outgrown );
+	if( workers[ 0 ]->visited )
+		printf( "visited: %u of %u inputs taken from earlier trajectories\n", answered, b.n );
 }
 
 
@@ -63,14 +418,97 @@ int main( int argc, char **argv )
 		printf( "Error: environment variable F2T_M undefined.\n" );
 		return 1;
 	}
-	uint64_t m = strtoul( env_F2T_M, NULL, 0 );
+	f2poly_t m = f2poly_parse( env_F2T_M );
 	
-	unsigned int l = strtoul( argv[ 1 ], NULL, 0 );
-	uint64_t bottom = strtoul( argv[ 2 ], NULL, 0 );
-	unsigned int n = strtoul( argv[ 3 ], NULL, 0 );
-	unsigned int timeout = strtoul( argv[ 4 ], NULL, 0 );
+	char *env_F2T_JUMP = getenv( "F2T_JUMP" );
+	unsigned int k = env_F2T_JUMP ? strtoul( env_F2T_JUMP, NULL, 0 ) : F2T_JUMP_DEFAULT;
 	
-	findperiod_loop( m, l, bottom, n, timeout );
-
+	block_t b;
+	if( !cycle_detector_parse( getenv( "F2T_DETECTOR" ), &b.detector ) )
+	{
+		printf( "Error: unknown cycle detector %s.\n", getenv( "F2T_DETECTOR" ) );
+		return 1;
+	}
+	
+	char *env_F2T_DP_BITS = getenv( "F2T_DP_BITS" );
+	unsigned int bits = env_F2T_DP_BITS ? strtoul( env_F2T_DP_BITS, NULL, 0 ) : 0;
+	if( bits > 63 )
+		bits = 63;
+	
+	char *env_F2T_THREADS = getenv( "F2T_THREADS" );
+	b.threads = env_F2T_THREADS ? strtoul( env_F2T_THREADS, NULL, 0 ) : std::thread::hardware_concurrency( );
+	if( !b.threads )
+		b.threads = 1;
+	
+	b.l = strtoul( argv[ 1 ], NULL, 0 );
+	b.bottom = strtoul( argv[ 2 ], NULL, 0 );
+	b.n = strtoul( argv[ 3 ], NULL, 0 );
+	b.timeout = strtoul( argv[ 4 ], NULL, 0 );
+	
+	unsigned int depth = argc > 5 ? strtoul( argv[ 5 ], NULL, 0 ) : 0;
+	b.census = argc > 6 && strtoul( argv[ 6 ], NULL, 0 );
+	if( depth > F2T_SIEVE_MAX )
+		depth = F2T_SIEVE_MAX;
+	
+	f2t_sieve_t *sieve = depth ? new f2t_sieve_t( m, depth ) : NULL;
+	b.sieve = sieve;
+	
+	// (the rest are only used by Brent's algorithm)
+	char *env_F2T_CATALOGUE = getenv( "F2T_CATALOGUE" );
+	char *env_F2T_TABLE = getenv( "F2T_TABLE" );
+	char *env_F2T_VISITED = getenv( "F2T_VISITED" );
+	char *env_F2T_ESCALATE = getenv( "F2T_ESCALATE" );
+	char *env_F2T_BATCH = getenv( "F2T_BATCH" );
+	bool brent = b.detector == DETECT_BRENT;
+	
+	const char *const brent_only[ ] = { "F2T_JUMP", "F2T_DP_BITS", "F2T_CATALOGUE", "F2T_TABLE", "F2T_VISITED", "F2T_ESCALATE", "F2T_BATCH", NULL };
+	cycle_detector_ignored( b.detector, brent_only );
+	
+	bool visited = brent && env_F2T_VISITED && strtoul( env_F2T_VISITED, NULL, 0 );
+	b.escalate = brent && env_F2T_ESCALATE ? strtoul( env_F2T_ESCALATE, NULL, 0 ) : 0;
+	bool batch = brent && env_F2T_BATCH && strcmp( env_F2T_BATCH, "0" ) && f2t_batch_t::supported( m, b.l );
+	
+	std::vector< worker_t* > workers;
+	int status = 0;
+	for( unsigned int t = 0; t < b.threads && !status; t++ )
+	{
+		worker_t *w = new worker_t( m );
+		workers.push_back( w );
+		w->f.set_jump( brent ? k : 0 );
+		
+		if( batch )
+			w->batch = new f2t_batch_t( m, b.l, k, strcmp( env_F2T_BATCH, "1" ) ? env_F2T_BATCH : NULL );
+		
+		// (the first thread's distinguished points and bitmap are shared
+		// with the others)
+		if( bits && brent )
+			w->points = t ? new distinguished_points_t( *workers[ 0 ]->points ) : new distinguished_points_t( bits );
+		if( visited )
+			w->visited = t ? new f2t_visited_t( *workers[ 0 ]->visited ) : new f2t_visited_t( b.l, b.bottom + 1, b.n );
+		
+		// (the catalogue can be opened more than once; it is locked for
+		// each of them)
+		if( env_F2T_CATALOGUE && brent )
+		{
+			w->catalogue = new cycle_catalogue_t( );
+			if( !w->catalogue->open( env_F2T_CATALOGUE, m.wordvector( ) ) )
+				status = 1;
+		}
+		
+		if( env_F2T_TABLE && brent && !status )
+		{
+			w->table = new f2t_table_t( );
+			if( !w->table->open( env_F2T_TABLE, m ) )
+				status = 1;
+		}
+	}
+	
+	if( !status )
+		findperiod_loop( m, b, workers, bits );
+	
+	delete sieve;
+	for( unsigned int t = 0; t < workers.size( ); t++ )
+		delete workers[ t ];
 	
+	return status;
 }
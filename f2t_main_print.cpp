@@ -5,7 +5,9 @@
  * 
  * Parameter for the mx+1 map is specified as an environment variable:
  * F2T_M
- * (stored in binary form, i.e. the k-th bit is the coefficient of t^k)
+ * (stored in binary form, i.e. the k-th bit is the coefficient of t^k; wide
+ * multipliers can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
  * 
  * Command line arguments: < l, bottom, timeout >
  * 		l: number of words in initial polynomial f
@@ -26,7 +28,7 @@ int main( int argc, char **argv )
 {
 	if( argc < 4 ) return 0;
 	
-	uint64_t m = strtoul( getenv( "F2T_M" ), NULL, 0 );
+	f2poly_t m = f2poly_parse( getenv( "F2T_M" ) );
 	
 	unsigned int l = strtoul( argv[ 1 ], NULL, 0 );
 	uint64_t bottom = strtoul( argv[ 2 ], NULL, 0 );
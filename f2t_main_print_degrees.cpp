@@ -5,7 +5,9 @@
  * 
  * Parameter for the mx+1 map is specified as an environment variable:
  * F2T_M
- * (stored in binary form, i.e. the k-th bit is the coefficient of t^k)
+ * (stored in binary form, i.e. the k-th bit is the coefficient of t^k; wide
+ * multipliers can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
  * 
  * Command line arguments: < l, bottom, timeout >
  * 		l: number of words in initial polynomial f
@@ -31,7 +33,7 @@ int main( int argc, char **argv )
 	unsigned int timeout = strtoul( argv[ 2 ], NULL, 0 );
 	unsigned int gap = strtoul( argv[ 3 ], NULL, 0 );
 	
-	uint64_t m = strtoul( getenv( "F2T_M" ), NULL, 0 );
+	f2poly_t m = f2poly_parse( getenv( "F2T_M" ) );
 	
 	f2t_sequence_t f( m );
 	f.setpoly( 1, b );
@@ -6,7 +6,22 @@
  * 
  * Parameter for the mx+1 map is specified as an environment variable:
  * F2T_M
- * (stored in binary form, i.e. the k-th bit is the coefficient of t^k)
+ * (stored in binary form, i.e. the k-th bit is the coefficient of t^k; wide
+ * multipliers can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
+ * 
+ * Optionally, F2T_JUMP sets k for the k-step jump table used by the cycle
+ * search (0 for single steps only, default 12; k is capped so that m^k
+ * fits in a word)
+ * 
+ * F2T_DETECTOR picks the cycle detection algorithm, brent (the default) or
+ * nivasch (see cycle_detector.h). nivasch takes single steps and ignores
+ * F2T_JUMP and F2T_TABLE, with a warning if they are set.
+ * 
+ * F2T_TABLE names a table of outcomes for all polynomials of low degree,
+ * made by f2t_main_table for the same m: Brent's algorithm then stops as
+ * soon as a trajectory gets down to its degree (see f2t_table.h). The
+ * output is the same.
  * 
  * Command line arguments: < l, bottom, timeout >
  * 		l: number of words in initial polynomial f
@@ -36,7 +51,20 @@ int main( int argc, char **argv )
 		printf( "Error: environment variable F2T_M undefined.\n" );
 		return 1;
 	}
-	uint64_t m = strtoul( env_F2T_M, NULL, 0 );
+	f2poly_t m = f2poly_parse( env_F2T_M );
+	
+	char *env_F2T_JUMP = getenv( "F2T_JUMP" );
+	unsigned int k = env_F2T_JUMP ? strtoul( env_F2T_JUMP, NULL, 0 ) : F2T_JUMP_DEFAULT;
+	
+	cycle_detector_t detector;
+	if( !cycle_detector_parse( getenv( "F2T_DETECTOR" ), &detector ) )
+	{
+		printf( "Error: unknown cycle detector %s.\n", getenv( "F2T_DETECTOR" ) );
+		return 1;
+	}
+	
+	const char *const brent_only[ ] = { "F2T_JUMP", "F2T_TABLE", NULL };
+	cycle_detector_ignored( detector, brent_only );
 	
 	unsigned int l = strtoul( argv[ 1 ], NULL, 0 );
 	uint64_t bottom = strtoul( argv[ 2 ], NULL, 0 );
@@ -44,7 +72,14 @@ int main( int argc, char **argv )
 	
 	f2t_sequence_t f( m );
 	f.setpoly( l, bottom );
+	f.set_jump( detector == DETECT_BRENT ? k : 0 );
+	
+	// (only used by Brent's algorithm)
+	f2t_table_t table;
+	char *env_F2T_TABLE = detector == DETECT_BRENT ? getenv( "F2T_TABLE" ) : NULL;
+	if( env_F2T_TABLE && !table.open( env_F2T_TABLE, m ) )
+		return 1;
 	
-	f2t_run_and_print( f, timeout );
+	f2t_run_and_print( f, timeout, detector, NULL, NULL, env_F2T_TABLE ? &table : NULL );
 	
 }
@@ -0,0 +1,64 @@
+/* f2t_main_table
+ * 
+ * This program works out the outcome of the mx+1 map in F_2[t] for every
+ * polynomial of degree <= D, i.e. the number of steps to 1, or the cycle
+ * it falls into and the number of steps before it gets there, and writes
+ * them to a table which the cycle search can use (see f2t_table.h).
+ * 
+ * Parameter for the mx+1 map is specified as an environment variable:
+ * F2T_M
+ * (stored in binary form, i.e. the k-th bit is the coefficient of t^k; wide
+ * multipliers can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
+ * 
+ * Command line arguments: < D, file > [ limit, maxdegree ]
+ * 		D: largest degree in the table (at most F2T_TABLE_MAX)
+ * 		file: where to write the table
+ * 		limit: number of steps to follow a trajectory for before giving up
+ * 			on it (default 2^20)
+ * 		maxdegree: degree above which to give up on a trajectory (default 256)
+ * 
+ */
+
+
+#include "f2t_table.h"
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 3 )
+	{
+		printf( "not enough arguments\n" );
+		return 0;
+	}
+	
+	char *env_F2T_M = getenv( "F2T_M" );
+	if( env_F2T_M == NULL )
+	{
+		printf( "Error: environment variable F2T_M undefined.\n" );
+		return 1;
+	}
+	f2poly_t m = f2poly_parse( env_F2T_M );
+	
+	unsigned int D = strtoul( argv[ 1 ], NULL, 0 );
+	unsigned int limit = argc > 3 ? strtoul( argv[ 3 ], NULL, 0 ) : F2T_TABLE_LIMIT_DEFAULT;
+	unsigned int maxdegree = argc > 4 ? strtoul( argv[ 4 ], NULL, 0 ) : F2T_TABLE_DEGREE_LIMIT_DEFAULT;
+	if( D > F2T_TABLE_MAX )
+		D = F2T_TABLE_MAX;
+	
+	if( !f2t_table_t::build( m, D, limit, maxdegree, argv[ 2 ] ) )
+		return 1;
+	
+	f2t_table_t table;
+	if( !table.open( argv[ 2 ], m ) )
+		return 1;
+	
+	printf( "table of outcomes up to degree %u for multiplier ", D );
+	m.printdec( );
+	printf( ": %u cycles\n", table.cycles( ) );
+	
+}
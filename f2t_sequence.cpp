@@ -2,25 +2,110 @@
 #include "f2poly.h"
 #include <cstdint>
 #include <cstdio>
+#include <mutex>
 
 
 
 
+/**********************************************************************/
+/**************************** JUMP TABLES *****************************/
+/**********************************************************************/
+
+
+template< class P >
+unsigned int f2t_jump_table_t<P>::cap( const f2poly_t &m, unsigned int k )
+{
+	if( m.size( ) > 1 )
+		return 0;
+	
+	if( k > F2T_JUMP_MAX )
+		k = F2T_JUMP_MAX;
+	if( m.degree && k * m.degree >= WORDLENGTH )
+		k = ( WORDLENGTH - 1 ) / m.degree;
+	
+	return k;
+}
+
+
+// the tables are never freed, a program only uses one or two of them
+template< class P >
+const f2t_jump_table_t<P> *f2t_jump_table_t<P>::get( const f2poly_t &m, unsigned int k )
+{
+	static std::mutex lock;
+	static std::vector< const f2t_jump_table_t* > tables;
+	
+	k = cap( m, k );
+	if( k < 2 )
+		return NULL;
+	
+	std::lock_guard< std::mutex > guard( lock );
+	
+	for( unsigned int i = 0; i < tables.size( ); i++ )
+		if( tables[ i ]->k == k && tables[ i ]->m == m )
+			return tables[ i ];
+	
+	tables.push_back( new f2t_jump_table_t( m, k ) );
+	return tables.back( );
+}
+
+
+// each entry is found by taking the k steps from x itself: f = x goes to
+// r, since h = 0. The terms on the way have degree < k + deg m^k, so they
+// fit in two words.
+template< class P >
+f2t_jump_table_t<P>::f2t_jump_table_t( const f2poly_t &m, unsigned int steps )
+	: m( m ), entries( uint64_t( 1 ) << steps ), k( steps ), mask( ( uint64_t( 1 ) << steps ) - 1 )
+{
+	f2poly_t power( 1, 1 );
+	for( unsigned int a = 0; a <= k; a++ )
+	{
+		powers.push_back( f2poly_multiplier_t< P >( power ) );
+		power *= m;
+	}
+	
+	std::vector<uint64_t> x( 1 );
+	for( x[ 0 ] = 0; x[ 0 ] <= mask; x[ 0 ]++ )
+	{
+		f2t_jump_entry_t &e = entries[ x[ 0 ] ];
+		f2poly_fixed<2> f( x );
+		
+		e.parities = 0;
+		e.odd = 0;
+		for( unsigned int j = 0; j < k; j++ )
+		{
+			if( f.parity( ) )
+			{
+				e.parities |= 1u << j;
+				e.odd++;
+				f.mxplus1( m.word( 0 ) );
+			}
+			else
+				f.divide( );
+		}
+		
+		e.r = f.bottomword( ) ^ ( ( powers[ e.odd ].poly( ).word( 0 ) ^ 1 ) >> 1 );
+	}
+}
+
+
+
 /**********************************************************************/
 /**************** CONSTRUCTORS AND INITIALIZERS ***********************/
 /**********************************************************************/
 
 
-void f2t_sequence_t::setpoly( std::vector<uint64_t> a )
+template< class P >
+void f2t_sequence_base_t<P>::setpoly( const std::vector<uint64_t> &a )
 {
-	poly = f2poly_t( a );
+	poly = P( a );
 	stepcount = 0;
 }
 
 
-void f2t_sequence_t::setpoly( unsigned int l, uint64_t bottom )
+template< class P >
+void f2t_sequence_base_t<P>::setpoly( unsigned int l, uint64_t bottom )
 {
-	poly = f2poly_t( l, bottom );
+	poly = P( l, bottom );
 	stepcount = 0;
 }
 
@@ -32,23 +117,66 @@ void f2t_sequence_t::setpoly( unsigned int l, uint64_t bottom )
 
 
 // apply mx+1 transformation
-void f2t_sequence_t::step( )
+template< class P >
+void f2t_sequence_base_t<P>::step( )
 {
-	if( poly.parity( ) )
-		poly = poly * multiplier + 1;
+	// this is
+	//     if( poly.parity( ) ) poly = poly * multiplier + 1;
+	//     poly.divide( );
+	// with the odd case done in place by the kernel bound to the multiplier
+	if( !poly.parity( ) )
+		poly.divide( );
+	else
+		multiplier.mxplus1( poly );
 	
-	poly.divide( );
 	stepcount++;
 }
 
 
-void f2t_sequence_t::print( )
+// a run of even terms is consumed all at once: the run is as long as the
+// number of zero coefficients at the bottom of f
+template< class P >
+unsigned int f2t_sequence_base_t<P>::step_even( unsigned int maxsteps )
+{
+	unsigned int k = poly.trailing_zeros( );
+	if( k > maxsteps )
+		k = maxsteps;
+	
+	poly.divide( k );
+	stepcount += k;
+	
+	return k;
+}
+
+
+// f = t^k*h + x goes to m^a*h + r. The odd step kernel does the multiply:
+// with x replaced by t^(k-1), f/t^(k-1) = t*h + 1 is odd, and the kernel
+// gives ( ( t*h + 1 )*m^a + 1 )/t = m^a*h + ( m^a + 1 )/t, where the
+// second term is already in the table's r. (If m(0) = 0 the kernel drops
+// the bottom bit, which is the same as rounding ( m^a + 1 )/t down.)
+template< class P >
+void f2t_sequence_base_t<P>::step_k( )
+{
+	const f2t_jump_entry_t &e = jump_entry( );
+	
+	poly += ( poly.bottomword( ) & jump->mask ) ^ bits[ jump->k - 1 ];
+	poly.divide( jump->k - 1 );
+	jump->power( e.odd ).mxplus1( poly );
+	poly += e.r;
+	
+	stepcount += jump->k;
+}
+
+
+template< class P >
+void f2t_sequence_base_t<P>::print( ) const
 {
 	poly.printdec( );
 }
 
 
-void f2t_sequence_t::print_sequence( unsigned int timeout )
+template< class P >
+void f2t_sequence_base_t<P>::print_sequence( unsigned int timeout )
 {
 	printf( "\ni = %6i, f = ", 0 );
 	poly.print( );
@@ -63,7 +191,8 @@ void f2t_sequence_t::print_sequence( unsigned int timeout )
 }
 
 
-void f2t_sequence_t::print_parity_sequence( unsigned int timeout )
+template< class P >
+void f2t_sequence_base_t<P>::print_parity_sequence( unsigned int timeout )
 {
 	printf( "%i", parity( ) );
 	
@@ -73,7 +202,8 @@ void f2t_sequence_t::print_parity_sequence( unsigned int timeout )
 }
 
 
-void f2t_sequence_t::print_sequence_degrees( unsigned int timeout, unsigned int gap )
+template< class P >
+void f2t_sequence_base_t<P>::print_sequence_degrees( unsigned int timeout, unsigned int gap )
 {
 	printf( "# %10s %10s\n", "i", "deg f" );
 	printf( "  %10i %10i\n", 0, degree( ) );
@@ -87,22 +217,34 @@ void f2t_sequence_t::print_sequence_degrees( unsigned int timeout, unsigned int
 }
 
 
-bool f2t_sequence_t::is_one( )
+template< class P >
+bool f2t_sequence_base_t<P>::is_one( )
 {
 	return poly.is_one( );
 }
 
 
-bool f2t_sequence_t::operator==( const f2t_sequence_t &other ) const
+template< class P >
+bool f2t_sequence_base_t<P>::operator==( const f2t_sequence_base_t &other ) const
 {
 	return poly == other.poly;
 }
 
 
-bool f2t_sequence_t::operator!=( const f2t_sequence_t &other ) const
+template< class P >
+bool f2t_sequence_base_t<P>::operator!=( const f2t_sequence_base_t &other ) const
 {
 	return !( *this == other );
 }
 
 
 
+// the polynomial types the sequence is used with
+template class f2t_sequence_base_t< f2poly_t >;
+template class f2t_sequence_base_t< f2poly_fixed<1> >;
+template class f2t_sequence_base_t< f2poly_fixed<2> >;
+template class f2t_sequence_base_t< f2poly_fixed<4> >;
+template class f2t_jump_table_t< f2poly_t >;
+template class f2t_jump_table_t< f2poly_fixed<1> >;
+template class f2t_jump_table_t< f2poly_fixed<2> >;
+template class f2t_jump_table_t< f2poly_fixed<4> >;
@@ -8,6 +8,12 @@
  * We store the current element f in F_2[t], as well as the number of
  * steps so far and the multiplier polynomial m in F_2[t]
  * 
+ * The class is a template over the polynomial type: f2t_sequence_t uses
+ * the dynamic f2poly_t, and f2t_sequence_base_t< f2poly_fixed<N> > keeps
+ * f inline in N words (see f2poly_fixed.h). A sequence can be converted
+ * to one with a different polynomial type, which is how a trajectory gets
+ * promoted when it outgrows a fixed width.
+ * 
  */
 
 
@@ -16,26 +22,109 @@
 #define F2T_SEQUENCE_H
 
 #include "f2poly.h"
+#include "f2poly_fixed.h"
+#include "f2poly_multiplier.h"
 #include <cstdint>
 #include <vector>
 
 
-class f2t_sequence_t
+// largest k for a jump table (it has 2^k entries of 16 bytes)
+#define F2T_JUMP_MAX 20
+
+// k used by the cycle finding drivers unless F2T_JUMP says otherwise
+#define F2T_JUMP_DEFAULT 12
+
+
+
+/* k-step jumps
+ *
+ * With no carries in F_2[t], the parities of the next k terms of a
+ * trajectory depend only on the k lowest coefficients of f. Writing
+ * f = t^k*h + x (deg x < k), k steps of the map take f to
+ *     m^a*h + r
+ * where a, the number of odd steps, and r depend only on x. The table
+ * holds a, r and the k parities for every x, and the multipliers for
+ * m^0, ..., m^k, so k steps cost one multiply instead of a.
+ *
+ * k is capped so that m^k fits in a word, which makes r fit in a word too;
+ * there is no table for multipliers wider than that.
+ */
+struct f2t_jump_entry_t
+{
+	uint64_t r;				// (with ( m^a + 1 )/t added, see step_k( ))
+	uint32_t parities;		// bit j is the parity of term j
+	uint32_t odd;			// a
+};
+
+
+template< class P >
+class f2t_jump_table_t
+{
+	private:
+		f2poly_t m;
+		std::vector< f2poly_multiplier_t< P > > powers;	// m^0 to m^k
+		std::vector< f2t_jump_entry_t > entries;
+		
+		f2t_jump_table_t( const f2poly_t &m, unsigned int steps );
+		
+	public:
+		const unsigned int k;
+		const uint64_t mask;	// the bits of f which pick the entry
+		
+		// the largest k <= requested one which works for m (0 if none does)
+		static unsigned int cap( const f2poly_t &m, unsigned int k );
+		
+		// the table for m and k (as capped), built on first use and shared
+		// by everything asking for the same one; NULL if k < 2
+		static const f2t_jump_table_t *get( const f2poly_t &m, unsigned int k );
+		
+		const f2t_jump_entry_t& lookup( uint64_t bottom ) const { return entries[ bottom & mask ]; }
+		const f2poly_multiplier_t< P >& power( unsigned int a ) const { return powers[ a ]; }
+};
+
+
+
+template< class P >
+class f2t_sequence_base_t
 {
+	template< class Q > friend class f2t_sequence_base_t;
+	
 	private:
-		f2poly_t poly;			// current point in the trajectory
+		P poly;					// current point in the trajectory
 		
-		uint64_t multiplier;	// m in F_2[t] used to define mx+1 map
+		// m in F_2[t] used to define mx+1 map, with the step kernel picked
+		// for its shape
+		f2poly_multiplier_t< P > multiplier;
 		
 		unsigned int stepcount;	// number of steps taken so far
 		
+		const f2t_jump_table_t< P > *jump;	// for step_k( ), or NULL
+		
 	public:
-		f2t_sequence_t( ) {};
-		f2t_sequence_t( uint64_t m ) : multiplier( m ) { }
-		f2t_sequence_t( uint64_t m, f2poly_t f ) : poly( f ), multiplier( m ), stepcount( 0 ) { }
+		typedef P poly_type;
+		typedef f2t_sequence_base_t< typename f2poly_wider< P >::type > wider_t;
+		
+		f2t_sequence_base_t( ) : stepcount( 0 ), jump( NULL ) {};
+		f2t_sequence_base_t( const f2poly_t &m ) : multiplier( m ), stepcount( 0 ), jump( NULL ) { }
+		f2t_sequence_base_t( const f2poly_t &m, P f ) : poly( f ), multiplier( m ), stepcount( 0 ), jump( NULL ) { }
+		
+		// copying keeps the word arrays the target already has (see
+		// f2poly_t), and moving just hands them over
+		f2t_sequence_base_t( const f2t_sequence_base_t &other ) = default;
+		f2t_sequence_base_t( f2t_sequence_base_t &&other ) = default;
+		f2t_sequence_base_t& operator=( const f2t_sequence_base_t &other ) = default;
+		f2t_sequence_base_t& operator=( f2t_sequence_base_t &&other ) = default;
+		
+		// same trajectory and step count, stored in another polynomial type
+		// (the caller has to check that f fits)
+		template< class Q >
+		explicit f2t_sequence_base_t( const f2t_sequence_base_t< Q > &other )
+			: poly( f2poly_words( other.poly ) ), multiplier( other.multiplier.poly( ) ),
+			stepcount( other.stepcount ),
+			jump( f2t_jump_table_t< P >::get( other.multiplier.poly( ), other.jump_steps( ) ) ) { }
 		
 		// initialize polynomial from list of words...
-		void setpoly( std::vector<uint64_t> a );
+		void setpoly( const std::vector<uint64_t> &a );
 		
 		// ... or from bottom word and number of words
 		void setpoly( unsigned int l, uint64_t bottom );
@@ -43,15 +132,45 @@ class f2t_sequence_t
 		// apply mx+1 map to move to next element of sequence
 		void step( );
 		
+		// take up to maxsteps steps at once, as long as they are all just
+		// divisions by t (f(0) = 0); returns the number of steps taken
+		unsigned int step_even( unsigned int maxsteps );
+		
+		// the highest degree the next step can reach, and whether that still
+		// fits in the polynomial type
+		unsigned int step_degree( ) const { return poly.degree + multiplier.degree( ); }
+		bool fits( ) const { return step_degree( ) <= P::max_degree; }
+		
+		// k steps at once with a jump table (see f2t_jump_table_t); set_jump
+		// picks the table for k (0 for none), and step_k needs jump_fits( )
+		void set_jump( unsigned int k ) { jump = f2t_jump_table_t< P >::get( multiplier.poly( ), k ); }
+		unsigned int jump_steps( ) const { return jump ? jump->k : 0; }
+		bool jump_fits( ) const { return jump && poly.degree + jump->k * multiplier.degree( ) <= P::max_degree; }
+		void step_k( );
+		
+		// the jump table entry for f, and the degree of the term j <= k steps
+		// ahead according to it (exact as long as degree( ) >= j)
+		const f2t_jump_entry_t& jump_entry( ) { return jump->lookup( poly.bottomword( ) ); }
+		unsigned int jump_degree( const f2t_jump_entry_t &e, unsigned int j ) const
+		{
+			return poly.degree + __builtin_popcount( e.parities & ( ( 1u << j ) - 1 ) ) * multiplier.degree( ) - j;
+		}
+		
 		
 		unsigned int count( ) { return stepcount; }
 		unsigned int degree( ) { return poly.degree; }
 		int parity( ) { return poly.parity( ); }
 		void reset_count( ) { stepcount = 0; }
+		void set_count( unsigned int n ) { stepcount = n; }
 		uint64_t bottomword( ) { return poly.bottomword( );	}
+		uint64_t hash( ) const { return poly.fingerprint( ); }	// f mod P, see f2poly.h
+		void wordvector( std::vector<uint64_t> &a ) const { poly.wordvector( a ); }	// words of f
 		bool is_one( );
 		
-		void print( ); // print f
+		// which kernel the odd steps use (see f2poly_multiplier.h)
+		const char *kernel_name( ) const { return multiplier.kernel_name( ); }
+		
+		void print( ) const; // print f
 		
 		// print all elements of sequence until number of steps reaches timeout
 		void print_sequence( unsigned int timeout );
@@ -63,14 +182,14 @@ class f2t_sequence_t
 		void print_parity_sequence( unsigned int timeout );
 		
 		
-		bool operator==( const f2t_sequence_t &other ) const;
-		bool operator!=( const f2t_sequence_t &other ) const;
-		
-		
-		~f2t_sequence_t( ) { };
+		bool operator==( const f2t_sequence_base_t &other ) const;
+		bool operator!=( const f2t_sequence_base_t &other ) const;
 };
 
 
+typedef f2t_sequence_base_t< f2poly_t > f2t_sequence_t;
+
+
 
 
 
@@ -0,0 +1,56 @@
+#include "f2t_sieve.h"
+#include "f2poly.h"
+#include <cstdint>
+#include <vector>
+
+
+
+f2t_sieve_t::f2t_sieve_t( const f2poly_t &m, unsigned int k )
+	: m( m ), drops( uint64_t( 1 ) << k, 0 ), k( k ), dropped( 0 )
+{
+	f2poly_t power( 1, 1 );
+	for( unsigned int a = 0; a <= k; a++ )
+	{
+		powers.push_back( power );
+		power *= m;
+	}
+	
+	// start from the single class mod t^0, whose trajectory is 0
+	if( k )
+		split( 0, 0, 0, f2poly_t( ) );
+}
+
+
+// split the class of x mod t^j into the two classes mod t^(j+1). The first
+// j steps from the class took a odd steps and took x itself to r, so they
+// take x + t^j to r + m^a; step j + 1 is then decided by the parity.
+void f2t_sieve_t::split( unsigned int j, uint64_t x, unsigned int a, const f2poly_t &r )
+{
+	for( uint64_t y = 0; y < 2; y++ )
+	{
+		uint64_t xy = x | ( y << j );
+		unsigned int b = a;
+		
+		f2poly_t f = r;
+		if( y )
+			f += powers[ a ];
+		
+		if( f.parity( ) )
+		{
+			f *= m;
+			f += 1;
+			b++;
+		}
+		f.divide( );
+		
+		// the degree is now deg f + b*deg m - ( j + 1 ): has it dropped?
+		if( b * m.degree < j + 1 )
+		{
+			for( uint64_t z = xy; z < drops.size( ); z += uint64_t( 1 ) << ( j + 1 ) )
+				drops[ z ] = j + 1;
+			dropped += drops.size( ) >> ( j + 1 );
+		}
+		else if( j + 1 < k )
+			split( j + 1, xy, b, f );
+	}
+}
@@ -0,0 +1,61 @@
+/* f2t_sieve_t
+ *
+ * Stopping time sieve for the mx+1 map in F_2[t]. As long as deg f >= k,
+ * the degrees of the first k terms of the trajectory of f are fixed by the
+ * k lowest coefficients of f: each odd step adds deg m - 1 to the degree,
+ * each even step takes off 1 (see f2t_jump_table_t in f2t_sequence.h). So
+ * whether the trajectory drops below deg f within k steps, and at which
+ * step, only depends on the residue class of f mod t^k. The sieve keeps
+ * that step for each of the 2^k classes.
+ *
+ * The table is built by going down the tree of residue classes mod t,
+ * t^2, ..., t^k; a class which has already dropped is not split any
+ * further.
+ *
+ */
+
+
+
+#ifndef F2T_SIEVE_H
+#define F2T_SIEVE_H
+
+#include "f2poly.h"
+#include <cstdint>
+#include <vector>
+
+
+// largest sieve depth (the table has 2^k bytes)
+#define F2T_SIEVE_MAX 24
+
+
+
+class f2t_sieve_t
+{
+	private:
+		f2poly_t m;
+		std::vector< f2poly_t > powers;		// m^0 to m^k
+		std::vector< uint8_t > drops;		// stopping time of each class, or 0
+		
+		unsigned int k;
+		uint64_t dropped;					// number of classes with a stopping time
+		
+		void split( unsigned int j, uint64_t x, unsigned int a, const f2poly_t &r );
+	
+	public:
+		f2t_sieve_t( const f2poly_t &m, unsigned int k );
+		
+		unsigned int depth( ) const { return k; }
+		
+		// the stopping time of f if it is at most k, 0 otherwise; f is given
+		// by its bottom word and has to have degree >= k
+		unsigned int stopping_time( uint64_t bottom ) const { return drops[ bottom & ( ( uint64_t( 1 ) << k ) - 1 ) ]; }
+		
+		// fraction of the residue classes mod t^k with stopping time <= k
+		double fraction( ) const { return (double) dropped / ( uint64_t( 1 ) << k ); }
+};
+
+
+
+
+
+#endif
@@ -0,0 +1,267 @@
+#include "f2t_table.h"
+#include "f2t_sequence.h"
+#include "cycle_detector.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+static const char f2t_table_magic[ 8 ] = { 'F', '2', 'T', 'T', 'A', 'B', 'L', '1' };
+
+
+// the entry for a polynomial k steps before one with entry v
+static uint32_t f2t_table_shift( uint32_t v, unsigned int k )
+{
+	if( v == F2T_TABLE_UNKNOWN )
+		return v;
+
+	uint64_t n = ( v & F2T_TABLE_CYCLE ? v & 0xffff : v ) + (uint64_t) k;
+
+	if( v & F2T_TABLE_CYCLE )
+		return n <= 0xffff ? ( v & ~0xffffu ) | n : F2T_TABLE_UNKNOWN;
+	return n < F2T_TABLE_UNKNOWN ? n : F2T_TABLE_UNKNOWN;
+}
+
+
+// The number of steps from the polynomial with bottom word y to the first
+// term of the cycle of length lambda it falls into: a second pointer
+// lambda steps ahead meets it there.
+static unsigned int f2t_table_entry_steps( const f2poly_t &m, uint64_t y, unsigned int lambda )
+{
+	f2t_sequence_t tortoise( m ), hare( m );
+	tortoise.setpoly( 1, y );
+	hare.setpoly( 1, y );
+	for( unsigned int k = 0; k < lambda; k++ )
+		hare.step( );
+
+	while( tortoise != hare )
+	{
+		tortoise.step( );
+		hare.step( );
+	}
+
+	return tortoise.count( );
+}
+
+
+// Each polynomial which isn't done yet is followed until it reaches one
+// which is, or until it comes back to a polynomial of degree <= D that it
+// has already been through, which means that it has found a new cycle, or
+// until it has gone on for too long.
+// Then all the polynomials of degree <= D on the way are filled in. The
+// trajectory may have entered the cycle above degree D, so the step at
+// which it did is found from the last of them before the cycle.
+bool f2t_table_t::build( const f2poly_t &m, unsigned int D, unsigned int limit, unsigned int maxdegree, const char *path )
+{
+	uint64_t n = uint64_t( 1 ) << ( D + 1 );
+	std::vector< uint32_t > entries( n, 0 );
+	std::vector< uint32_t > lambdas;
+
+	entries[ 1 ] = 1;		// 1 reaches 1 after 0 steps
+
+	std::unordered_map< uint64_t, unsigned int > seen;		// and at which step
+	std::vector< std::pair< uint64_t, unsigned int > > path_terms;
+	f2t_sequence_t x( m );
+
+	for( uint64_t g = 0; g < n; g++ )
+	{
+		if( entries[ g ] )
+			continue;
+
+		x.setpoly( 1, g );
+		seen.clear( );
+		path_terms.clear( );
+
+		uint32_t v = F2T_TABLE_UNKNOWN;		// entry reached, and when
+		unsigned int at = 0;
+		bool cycle = false;
+
+		while( 1 )
+		{
+			at = x.count( );
+
+			if( x.degree( ) <= D )
+			{
+				uint64_t y = x.bottomword( );
+				if( entries[ y ] )
+				{
+					v = entries[ y ];
+					break;
+				}
+
+				std::unordered_map< uint64_t, unsigned int >::iterator it = seen.find( y );
+				if( it != seen.end( ) )
+				{
+					cycle = true;
+					break;
+				}
+
+				seen[ y ] = at;
+				path_terms.push_back( std::make_pair( y, at ) );
+			}
+
+			if( at >= limit || x.degree( ) > maxdegree )
+				break;
+
+			x.step( );
+		}
+
+		if( cycle )
+		{
+			// the terms from the first time round are in the cycle, the
+			// ones before aren't
+			unsigned int first = seen[ x.bottomword( ) ];
+			unsigned int before = 0;
+			while( before < path_terms.size( ) && path_terms[ before ].second < first )
+				before++;
+
+			unsigned int entry = first;
+			if( before )
+				entry = path_terms[ before - 1 ].second + f2t_table_entry_steps( m, path_terms[ before - 1 ].first, at - first );
+
+			v = F2T_TABLE_UNKNOWN;
+			if( lambdas.size( ) < 0x8000 )
+			{
+				v = F2T_TABLE_CYCLE | lambdas.size( ) << 16;
+				lambdas.push_back( at - first );
+			}
+
+			for( unsigned int k = 0; k < path_terms.size( ); k++ )
+				entries[ path_terms[ k ].first ] = f2t_table_shift( v, k < before ? entry - path_terms[ k ].second : 0 );
+		}
+		else
+		{
+			// reaching a polynomial in a cycle, the trajectory may have
+			// entered it earlier (none of the terms so far are in it, or
+			// they would have been done with the cycle)
+			if( ( v & F2T_TABLE_CYCLE ) && !( v & 0xffff ) )
+				at = path_terms.back( ).second + f2t_table_entry_steps( m, path_terms.back( ).first, lambdas[ ( v >> 16 ) & 0x7fff ] );
+
+			for( unsigned int k = 0; k < path_terms.size( ); k++ )
+				entries[ path_terms[ k ].first ] = f2t_table_shift( v, at - path_terms[ k ].second );
+		}
+	}
+
+
+	FILE *file = fopen( path, "wb" );
+	if( file == NULL )
+	{
+		printf( "Error: can't write %s.\n", path );
+		return false;
+	}
+
+	std::vector< uint64_t > words = m.wordvector( );
+	uint32_t ncycles = lambdas.size( );
+	if( ncycles % 2 )
+		lambdas.push_back( 0 );
+
+	f2t_table_header_t h;
+	memcpy( h.magic, f2t_table_magic, sizeof( h.magic ) );
+	h.degree = D;
+	h.ncycles = ncycles;
+	h.nwords = words.size( );
+	h.reserved = 0;
+
+	bool ok = fwrite( &h, sizeof( h ), 1, file ) == 1
+		&& fwrite( words.data( ), sizeof( uint64_t ), words.size( ), file ) == words.size( )
+		&& fwrite( lambdas.data( ), sizeof( uint32_t ), lambdas.size( ), file ) == lambdas.size( )
+		&& fwrite( entries.data( ), sizeof( uint32_t ), n, file ) == n;
+
+	if( fclose( file ) || !ok )
+	{
+		printf( "Error: can't write %s.\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+
+f2t_table_t::~f2t_table_t( )
+{
+	if( map )
+		munmap( map, map_size );
+}
+
+
+bool f2t_table_t::open( const char *path, const f2poly_t &m )
+{
+	int fd = ::open( path, O_RDONLY );
+	struct stat st;
+	if( fd < 0 || fstat( fd, &st ) )
+	{
+		if( fd >= 0 )
+			close( fd );
+		printf( "Error: can't open table %s.\n", path );
+		return false;
+	}
+
+	map_size = st.st_size;
+	map = map_size >= sizeof( f2t_table_header_t ) ? mmap( NULL, map_size, PROT_READ, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+	close( fd );
+	if( map == MAP_FAILED )
+	{
+		map = NULL;
+		printf( "Error: can't map table %s.\n", path );
+		return false;
+	}
+
+	const f2t_table_header_t *h = (const f2t_table_header_t *) map;
+	const uint64_t *words = (const uint64_t *) ( h + 1 );
+
+	if( memcmp( h->magic, f2t_table_magic, sizeof( h->magic ) ) || h->degree > F2T_TABLE_MAX
+	|| map_size != sizeof( *h ) + h->nwords * sizeof( uint64_t ) + ( ( h->ncycles + 1 ) / 2 * 2 + ( uint64_t( 2 ) << h->degree ) ) * sizeof( uint32_t ) )
+	{
+		printf( "Error: %s is not a table.\n", path );
+		return false;
+	}
+
+	if( m.wordvector( ) != std::vector< uint64_t >( words, words + h->nwords ) )
+	{
+		printf( "Error: table %s is for a different multiplier.\n", path );
+		return false;
+	}
+
+	d = h->degree;
+	lambdas = (const uint32_t *) ( words + h->nwords );
+	entries = lambdas + ( h->ncycles + 1 ) / 2 * 2;
+
+	return true;
+}
+
+
+bool f2t_table_t::lookup( uint64_t f, unsigned int step, unsigned int timeout, unsigned int *mu, unsigned int *lambda ) const
+{
+	uint32_t v = entries[ f ];
+	if( v == F2T_TABLE_UNKNOWN )
+		return false;
+
+	// reaches 1; at the timeout itself that still counts
+	if( !( v & F2T_TABLE_CYCLE ) )
+	{
+		uint64_t n = step + (uint64_t) v - 1;
+		if( n > timeout )
+			return false;
+
+		*mu = n;
+		*lambda = 0;
+		return true;
+	}
+
+	unsigned int l = lambdas[ ( v >> 16 ) & 0x7fff ];
+	unsigned int e = v & 0xffff;
+
+	// if f is in the cycle, mu <= step, which may or may not be soon enough
+	if( brent_detection_step( step + e, l ) >= timeout )
+		return false;
+
+	*mu = e ? step + e : 0;
+	*lambda = l;
+	return true;
+}
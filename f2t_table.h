@@ -0,0 +1,101 @@
+/* f2t_table_t
+ *
+ * The outcome of the mx+1 map in F_2[t], for one m, for every polynomial
+ * of degree <= D: the number of steps to 1, or the cycle it falls into and
+ * the number of steps before it gets there. It is built once by
+ * f2t_main_table and written to a file, which the cycle search maps into
+ * memory, so that a trajectory can finish as soon as its degree drops to D.
+ *
+ * The file is a header, the words of m, the length of each cycle (as 32
+ * bit words, padded to a multiple of 2), and then an entry for each
+ * polynomial, indexed by its bottom word:
+ *     n < F2T_TABLE_UNKNOWN:	reaches 1 after n - 1 steps
+ *     F2T_TABLE_UNKNOWN:		not known
+ *     F2T_TABLE_CYCLE + c*2^16 + e:	enters cycle c after e steps
+ * Trajectories which didn't finish within the step limit of the build,
+ * went above its degree limit, or don't fit in an entry, are not known. (While the table is being built,
+ * 0 marks the entries not done yet.)
+ *
+ */
+
+
+
+#ifndef F2T_TABLE_H
+#define F2T_TABLE_H
+
+#include "f2poly.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// largest D (the table has 2^(D+1) entries of 4 bytes)
+#define F2T_TABLE_MAX 30
+
+// steps the build follows one trajectory for before giving up on it
+#define F2T_TABLE_LIMIT_DEFAULT ( 1u << 20 )
+
+// degree above which the build gives up on a trajectory (most of those
+// which get that far just keep growing)
+#define F2T_TABLE_DEGREE_LIMIT_DEFAULT 256
+
+
+#define F2T_TABLE_CYCLE ( 1u << 31 )
+#define F2T_TABLE_UNKNOWN ( F2T_TABLE_CYCLE - 1 )
+
+
+struct f2t_table_header_t
+{
+	char magic[ 8 ];
+	uint32_t degree;		// D
+	uint32_t ncycles;
+	uint32_t nwords;		// of m
+	uint32_t reserved;
+};
+
+
+class f2t_table_t
+{
+	private:
+		void *map;
+		size_t map_size;
+
+		unsigned int d;
+		const uint32_t *lambdas;	// length of each cycle
+		const uint32_t *entries;
+
+	public:
+		unsigned int hits;			// trajectories finished from the table
+
+		f2t_table_t( ) : map( NULL ), map_size( 0 ), d( 0 ), lambdas( NULL ), entries( NULL ), hits( 0 ) { }
+		~f2t_table_t( );
+
+		// compute the table for m and D, following each trajectory for at
+		// most limit steps and up to degree maxdegree, and write it to
+		// path. Returns false (with a message) if it can't.
+		static bool build( const f2poly_t &m, unsigned int D, unsigned int limit, unsigned int maxdegree, const char *path );
+
+		// map the table at path, which has to be for m. Returns false (with
+		// a message) if it can't.
+		bool open( const char *path, const f2poly_t &m );
+
+		unsigned int degree( ) const { return d; }
+
+		// A trajectory is at the polynomial with bottom word f (of degree
+		// <= D) after step steps. Returns false if the table doesn't know,
+		// or if Brent's algorithm would have timed out first. Otherwise sets
+		// mu and lambda; if f is already in the cycle, mu is left 0 for the
+		// caller to find.
+		bool lookup( uint64_t f, unsigned int step, unsigned int timeout, unsigned int *mu, unsigned int *lambda ) const;
+
+		// f is in a cycle according to the table
+		bool in_cycle( uint64_t f ) const { return ( entries[ f ] & F2T_TABLE_CYCLE ) && !( entries[ f ] & 0xffff ); }
+
+		unsigned int cycles( ) const { return ( (const f2t_table_header_t *) map )->ncycles; }
+};
+
+
+
+
+
+#endif
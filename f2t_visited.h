@@ -0,0 +1,184 @@
+/* f2t_visited_t
+ *
+ * The starts of a block in f2t_main_allcycles which earlier trajectories in
+ * the block have landed on. A trajectory from one start often goes through
+ * others in the block (same number of words, bottom word in the range);
+ * each of those it lands on is kept, with its step, and once the
+ * trajectory's outcome is known they are marked in a bitmap over the block,
+ * with that outcome. When the loop gets to a marked start, its sigma, mu
+ * and lambda are shifted over as for a distinguished point (see
+ * distinguished_points.h), and it isn't run at all. A start the loop has
+ * got to is marked too, with no outcome, so that it isn't kept again.
+ *
+ * The threads share the bitmap and the outcomes, under a lock: each has
+ * its own copy of the f2t_visited_t for its current trajectory.
+ *
+ * As there, only what Brent's algorithm would have given is used. Starts
+ * that jumps or runs of divisions by t pass over are not seen, so the cycle
+ * search stops at every term with the degree of a start while this is on.
+ *
+ */
+
+
+#ifndef F2T_VISITED_H
+#define F2T_VISITED_H
+
+#include "distinguished_points.h"
+#include "f2poly.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+class f2t_visited_t
+{
+	private:
+		typedef distinguished_points_t::entry_t entry_t;
+		
+		unsigned int l;
+		uint64_t first, n;			// bottom word of the first start, number of starts
+		unsigned int lo, hi;		// degrees of the starts
+		uint64_t top;				// hash of t^{64*(l-1)}
+		
+		struct marks_t
+		{
+			std::mutex lock;
+			std::vector< uint64_t > bits;				// starts with an outcome, or done
+			std::unordered_map< uint64_t, entry_t > outcomes;	// which, by index
+			
+			marks_t( uint64_t n ) : bits( ( n + 63 ) / 64, 0 ) { }
+		};
+		
+		std::shared_ptr< marks_t > marks;
+		std::vector< std::pair< uint64_t, entry_t > > pending;	// current trajectory
+		
+		// are the words of x between the top and bottom ones all 0?
+		template< class S >
+		bool middle_zero( S &x ) const
+		{
+			std::vector< uint64_t > a;
+			x.wordvector( a );
+			for( size_t j = 1; j + 1 < a.size( ); j++ )
+				if( a[ j ] )
+					return false;
+			
+			return true;
+		}
+		
+	public:
+		unsigned int answered;		// starts which weren't run
+		
+		// the block of n starts with l words, from bottom word first on
+		f2t_visited_t( unsigned int l, uint64_t first, uint64_t n )
+			: l( l ), first( first ), n( n ), top( f2poly_t( l, 0 ).fingerprint( ) ),
+			marks( new marks_t( n ) ), answered( 0 )
+		{
+			lo = l > 1 ? WORDLENGTH * ( l - 1 ) : 63 - __builtin_clzll( first | 1 );
+			hi = l > 1 ? lo : 63 - __builtin_clzll( ( first + n - 1 ) | 1 );
+		}
+		
+		// another thread's view of the same marks, with its own current
+		// trajectory and count of answers
+		f2t_visited_t( const f2t_visited_t &other )
+			: l( other.l ), first( other.first ), n( other.n ), lo( other.lo ), hi( other.hi ), top( other.top ),
+			marks( other.marks ), answered( 0 ) { }
+		
+		// some start has degree d
+		bool start_degree( unsigned int d ) const { return d >= lo && d <= hi; }
+		
+		// divisions by t from degree d down to the next start degree below
+		// it, or 0 if there is none
+		unsigned int steps_to_start( unsigned int d ) const { return d > hi ? d - hi : d > lo ? 1 : 0; }
+		
+		// if x is one of the starts, its index. Below 3 words the degree and
+		// bottom word settle it; above, the words in between have to be 0,
+		// which the hash checks first and the words confirm
+		template< class S >
+		bool find( S &x, uint64_t *k ) const
+		{
+			if( !start_degree( x.degree( ) ) || x.bottomword( ) - first >= n )
+				return false;
+			if( l > 2 && ( x.hash( ) != ( top ^ x.bottomword( ) ) || !middle_zero( x ) ) )
+				return false;
+			
+			*k = x.bottomword( ) - first;
+			return true;
+		}
+		
+		// the current trajectory has landed on x after step steps
+		template< class S >
+		void add( S &x, unsigned int step )
+		{
+			uint64_t k;
+			if( find( x, &k ) )
+			{
+				entry_t e = { step, 0, 0, 0, 0 };
+				pending.push_back( std::make_pair( k, e ) );
+			}
+		}
+		
+		// the current trajectory is done; its starts are marked unless it
+		// timed out, or they already are
+		void finish( unsigned int deg0, bool resolved, unsigned int mu, unsigned int lambda, unsigned int sigma )
+		{
+			std::unique_lock< std::mutex > guard( marks->lock, std::defer_lock );
+			if( resolved && !pending.empty( ) )
+				guard.lock( );
+			
+			for( unsigned int j = 0; resolved && j < pending.size( ); j++ )
+			{
+				uint64_t k = pending[ j ].first;
+				if( marks->bits[ k / 64 ] >> ( k % 64 ) & 1 )
+					continue;
+				
+				entry_t e = pending[ j ].second;
+				e.deg0 = deg0;
+				e.mu = mu;
+				e.lambda = lambda;
+				e.sigma = sigma;
+				marks->outcomes.insert( std::make_pair( k, e ) );
+				marks->bits[ k / 64 ] |= uint64_t( 1 ) << ( k % 64 );
+			}
+			
+			pending.clear( );
+		}
+		
+		// The loop has got to the start x. Returns false if it has to be
+		// run; otherwise sets sigma, mu and lambda from its mark.
+		template< class S >
+		bool answer( S &x, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+		{
+			uint64_t k;
+			if( !find( x, &k ) )
+				return false;
+			
+			std::unique_lock< std::mutex > guard( marks->lock );
+			if( !( marks->bits[ k / 64 ] >> ( k % 64 ) & 1 ) )
+			{
+				marks->bits[ k / 64 ] |= uint64_t( 1 ) << ( k % 64 );
+				return false;
+			}
+			
+			// (it won't come up again)
+			std::unordered_map< uint64_t, entry_t >::iterator it = marks->outcomes.find( k );
+			if( it == marks->outcomes.end( ) )
+				return false;
+			
+			entry_t e = it->second;
+			marks->outcomes.erase( it );
+			guard.unlock( );
+			
+			*sigma = 0;
+			if( !distinguished_points_t::shift( e, 0, x.degree( ), timeout, mu, lambda, sigma ) )
+				return false;
+			
+			answered++;
+			return true;
+		}
+};
+
+
+
+#endif
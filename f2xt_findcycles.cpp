@@ -2,37 +2,287 @@
 #include "f2xt_findcycles.h"
 #include <cstdio>
 #include <cstdint>
+#include <vector>
 
 
 
+// Can the hare take k steps at once (see f2xt_jump_table_t)? As in
+// f2t_can_jump, the jump must not reach the timeout or the next power of 2
+// before its last step, and while sigma is 0 none of the terms it skips may
+// be the first with degree < deg0, which the lower bound from jump_low( )
+// has to rule out. The other things the Brent loop stops at are seen from
+// where the jump lands (see f2xt_brent).
+template< class S >
+static bool f2xt_can_jump( S &hare, unsigned int left, unsigned int deg0, unsigned int timeout, unsigned int sigma )
+{
+	unsigned int k = hare.jump_steps( );
+	
+	if( !k || k > left || k > timeout - hare.count( ) || !hare.jump_fits( ) )
+		return false;
+	
+	return sigma || !deg0 || hare.jump_low( ) >= deg0;
+}
+
+
+// the k - 1 terms after x in ahead[ 1 ] to ahead[ k - 1 ], or false if
+// they might not all fit in S
+template< class S >
+static bool f2xt_terms_ahead( const S &x, unsigned int k, typename S::mark_t *ahead )
+{
+	S y = x;
+	for( unsigned int j = 1; j < k; j++ )
+	{
+		if( !y.fits( ) )
+			return false;
+		
+		y.step( );
+		y.mark( ahead[ j ] );
+	}
+	
+	return true;
+}
+
+
+// take n steps, k at a time where they fit
+template< class S >
+static void f2xt_advance( S &x, unsigned int n )
+{
+	unsigned int k = x.jump_steps( );
+	for( unsigned int j = 0; j < n; )
+	{
+		if( k && j + k <= n && x.jump_fits( ) )
+		{
+			x.step_k( );
+			j += k;
+		}
+		else
+		{
+			x.step( );
+			j++;
+		}
+	}
+}
+
+
+// Once lambda is known, find mu: start the tortoise at a term which comes
+// no later than mu, and the hare lambda steps ahead, then step both
+// forward together until they agree. All the terms involved have to fit
+// in S.
+template< class S >
+static unsigned int f2xt_find_mu( S tortoise, unsigned int lambda )
+{
+	S hare = tortoise;
+	
+	// set the tortoise and hare (lambda) steps apart
+	f2xt_advance( hare, lambda );
+	
+	// now iterate until they're equal. Once they are equal they stay
+	// equal, so if a jump of both lands on equal terms they may have met
+	// earlier, and they go back and take single steps from there
+	typename S::mark_t tmark, hmark;
+	bool jumps = tortoise.jump_steps( );
+	while( tortoise != hare )
+	{
+		if( jumps && tortoise.jump_fits( ) && hare.jump_fits( ) )
+		{
+			tortoise.mark( tmark );
+			hare.mark( hmark );
+			tortoise.step_k( );
+			hare.step_k( );
+			
+			if( tortoise == hare )
+			{
+				tortoise.go_back( tmark );
+				hare.go_back( hmark );
+				jumps = false;
+			}
+			continue;
+		}
+		
+		tortoise.step( );
+		hare.step( );
+	}
+	
+	return tortoise.count( );
+}
+
+
+// The latest of the checkpoints which comes before the cycle, or f if
+// there is none, found by binary search as in f2t_findcycles.cpp.
+template< class S >
+static S f2xt_mu_start( const f2xt_sequence_t &f, std::vector< S > &checkpoints, unsigned int lambda )
+{
+	int first = 0;
+	while( first < (int) checkpoints.size( ) && 2 * (uint64_t) checkpoints[ first ].count( ) <= lambda )
+		first++;
+	
+	// checkpoints[ lo ] is before the cycle, checkpoints[ hi ] is in it
+	int lo = first - 1;
+	int hi = checkpoints.size( );
+	while( hi - lo > 1 )
+	{
+		int mid = ( lo + hi ) / 2;
+		S x = checkpoints[ mid ];
+		f2xt_advance( x, lambda );
+		
+		if( x == checkpoints[ mid ] )
+			hi = mid;
+		else
+			lo = mid;
+	}
+	
+	return lo >= first ? checkpoints[ lo ] : S( f );
+}
+
+
+// The search for mu when the hare is known to be in the cycle but hasn't
+// been all the way round it yet, so the terms to come may not fit in S:
+// it runs on f2xt_sequence_t instead.
+template< class S >
+static unsigned int f2xt_find_mu_wide( const f2xt_sequence_t &f, std::vector< S > &checkpoints, unsigned int lambda )
+{
+	std::vector< f2xt_sequence_t > wide;
+	for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+		wide.push_back( f2xt_sequence_t( checkpoints[ k ] ) );
+	
+	return f2xt_find_mu( f2xt_mu_start( f, wide, lambda ), lambda );
+}
+
+
+// the key of the term x in the catalogue and among the distinguished
+// points: the words of f0, then those of f1, then the number of words of f0
+template< class S >
+static void f2xt_cycle_key( const S &x, std::vector< uint64_t > &key )
+{
+	std::vector< uint64_t > a1;
+	x.wordvectors( key, a1 );
+	
+	size_t n0 = key.size( );
+	key.insert( key.end( ), a1.begin( ), a1.end( ) );
+	key.push_back( n0 );
+}
+
+
+// add the cycle of length lambda through x to the catalogue, under its
+// smallest term
+template< class S >
+static void f2xt_catalogue_cycle( const S &x, unsigned int lambda, cycle_catalogue_t *catalogue )
+{
+	f2xt_sequence_t y = f2xt_sequence_t( x );
+	std::vector< uint64_t > hashes, key, k;
+	
+	f2xt_cycle_key( y, key );
+	for( unsigned int j = 0; j < lambda; j++ )
+	{
+		hashes.push_back( y.hash( ) );
+		f2xt_cycle_key( y, k );
+		if( cycle_catalogue_t::key_less( k, key ) )
+			key.swap( k );
+		
+		y.step( );
+	}
+	
+	catalogue->add( key, lambda, hashes );
+}
+
+
+// Is x in a cycle no longer than maxlength? Steps a copy on to see, and
+// returns the length of the cycle, or 0 (also if it gets to 0, where
+// Brent's algorithm stops instead). low is set to the number of
+// steps to the first term with degree < deg0 on the way, or 0. The terms
+// further on may not fit in S, so this runs on f2xt_sequence_t.
+template< class S >
+static unsigned int f2xt_cycle_length( const S &x, unsigned int maxlength, unsigned int deg0, unsigned int *low )
+{
+	f2xt_sequence_t start = f2xt_sequence_t( x );
+	f2xt_sequence_t y = start;
+	*low = 0;
+	
+	for( unsigned int j = 1; j <= maxlength; j++ )
+	{
+		y.step( );
+		if( y.is_zero( ) )
+			return 0;
+		
+		if( !*low && y.degree( ) < deg0 )
+			*low = j;
+		
+		if( y == start )
+			return j;
+	}
+	
+	return 0;
+}
+
+
+// keep where Brent's algorithm got to when it timed out, for f2xt_resume
+template< class S >
+static void f2xt_save_state( f2xt_brent_state_t *state, std::vector< S > &checkpoints, S &tortoise, S &hare, unsigned int i, unsigned int lambda, unsigned int sigma )
+{
+	state->checkpoints.clear( );
+	for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+		state->checkpoints.push_back( f2xt_sequence_t( checkpoints[ k ] ) );
+	
+	state->tortoise = f2xt_sequence_t( tortoise );
+	state->hare = f2xt_sequence_t( hare );
+	state->i = i;
+	state->lambda = lambda;
+	state->sigma = sigma;
+	state->maxdegree = S::poly_type::max_degree;
+}
+
+
 // find cycle in sequence starting at f using Brent's algorithm
 // mu is the number of iterations until it becomces periodic
 // lambda is the length of the period
 // returns 0 unless the iteration times out, in which case it
 // returns the degree where it stopped
-unsigned int f2xt_findperiod( f2xt_sequence_t f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma)
+//
+// As in f2t_findcycles.cpp, this is the part after the first step, with
+// the tortoise and hare stored as S and promoted to a wider type when the
+// hare outgrows S. The tortoise positions the hare leaves behind are kept
+// in checkpoints for the search for mu. If it times out and state isn't
+// NULL, the state is saved there.
+template< class S >
+static unsigned int f2xt_brent( const f2xt_sequence_t &f, std::vector< S > &checkpoints, S tortoise, S hare, unsigned int i, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2xt_brent_state_t *state )
 {
-	f2xt_sequence_t tortoise = f2xt_sequence_t( f );	// tortoise
-	f2xt_sequence_t hare = f2xt_sequence_t( f );
-	hare.step( );										// hare	
+	// for the jumps: the terms after the tortoise (worked out once needed,
+	// ahead_known = 1, or 2 if they don't fit in S and there are no jumps
+	// until the next power of 2), and how many single steps to take before
+	// jumping again
+	typename S::mark_t ahead[ F2XT_JUMP_MAX ], before;
+	unsigned int ahead_known = 0;
+	unsigned int singles = 0;
 	
-	unsigned int i = 1;			// current power of 2
-	*lambda = 1;				// period
-	*mu = 0;					// time to begin periodic part
-	*sigma = 0;
-	unsigned int deg0 = tortoise.degree( );
+	std::vector< uint64_t > key;	// of a distinguished point
 	
-	
-	// until the tortoise and hare are equal (or timeout)
+	// until the tortoise and hare are equal (or timeout). Once the terms
+	// are stored as f2poly_t, this compares their fingerprints, and only
+	// goes through the words when those agree
 	while( hare.count( ) < timeout && !hare.is_zero( ) && tortoise != hare )
 	{	
+		// promote to a wider polynomial type if the next step won't fit
+		if( !hare.fits( ) )
+		{
+			typedef typename S::wider_t W;
+			std::vector< W > wider;
+			for( unsigned int k = 0; k < checkpoints.size( ); k++ )
+				wider.push_back( W( checkpoints[ k ] ) );
+			
+			return f2xt_brent( f, wider, W( tortoise ), W( hare ), i, deg0, timeout, mu, lambda, sigma, points, catalogue, state );
+		}
 		
 		// should we advance i to the next power of 2?
 		if( i == *lambda )
 		{
+			if( checkpoints.size( ) == BRENT_CHECKPOINTS_MAX )
+				checkpoints.erase( checkpoints.begin( ) );
+			checkpoints.push_back( tortoise );
+			
 			tortoise = hare;
 			i <<= 1;
 			*lambda = 0;
+			ahead_known = 0;
 		}
 		
 		// if this is the first term with degree < degree of initial poly,
@@ -40,6 +290,75 @@ unsigned int f2xt_findperiod( f2xt_sequence_t f, unsigned int timeout, unsigned
 		if( !*sigma && hare.degree( ) < deg0 )
 			*sigma = hare.count( );
 		
+		// stop at a distinguished point which an earlier trajectory has
+		// been through (see distinguished_points.h)
+		if( points && points->is_distinguished( hare.hash( ) ) )
+		{
+			f2xt_cycle_key( hare, key );
+			const distinguished_points_t::entry_t *e = points->find( hare.hash( ), key );
+			if( e && points->inherit( *e, hare.count( ), deg0, timeout, mu, lambda, sigma ) )
+			{
+				if( !*mu )
+					*mu = f2xt_find_mu_wide( f, checkpoints, *lambda );
+				return 0;
+			}
+			
+			points->add( hare.hash( ), key, hare.count( ) );
+		}
+		
+		// stop once the hare is in a cycle in the catalogue: then every
+		// term from here on is one of the next lambda
+		if( catalogue && catalogue->may_contain( hare.hash( ) ) )
+		{
+			unsigned int low, length = f2xt_cycle_length( hare, catalogue->max_lambda( ), deg0, &low );
+			if( length && brent_detection_step( hare.count( ), length ) < timeout )
+			{
+				if( !*sigma && low )
+					*sigma = hare.count( ) + low;
+				*lambda = length;
+				*mu = f2xt_find_mu_wide( f, checkpoints, length );
+				catalogue->hits++;
+				return 0;
+			}
+			
+			// (if Brent's algorithm might time out first, carry on without
+			// looking again)
+			if( length )
+				catalogue = NULL;
+		}
+		
+		// k steps at once. If the hare was 0 or met the tortoise at one of
+		// the terms it skips, it lands on 0 or on one of the k - 1 terms
+		// after the tortoise (it stays on the same trajectory), and then it
+		// goes back and takes single steps past them
+		if( singles )
+			singles--;
+		else if( ahead_known < 2 && f2xt_can_jump( hare, i - *lambda, deg0, timeout, *sigma ) )
+		{
+			unsigned int k = hare.jump_steps( );
+			if( !ahead_known )
+				ahead_known = f2xt_terms_ahead( tortoise, k, ahead ) ? 1 : 2;
+			
+			if( ahead_known == 1 )
+			{
+				hare.mark( before );
+				hare.step_k( );
+				
+				bool back = hare.is_zero( );
+				for( unsigned int j = 1; j < k && !back; j++ )
+					back = hare.is_at( ahead[ j ] );
+				
+				if( !back )
+				{
+					*lambda += k;
+					continue;
+				}
+				
+				hare.go_back( before );
+				singles = k - 1;
+			}
+		}
+		
 		hare.step( );				// hare steps foward
 		(*lambda)++;				// period counter
 		
@@ -62,58 +381,281 @@ unsigned int f2xt_findperiod( f2xt_sequence_t f, unsigned int timeout, unsigned
 	// if we timed out...
 	if( hare.count( ) >= timeout )
 	{
+		if( state )
+			f2xt_save_state( state, checkpoints, tortoise, hare, i, *lambda, *sigma );
+		
 		*mu = 0;
 		*lambda = 0;
-		return hare.degree( );	// return 1
+		// return the degree at which we timed out (1 for the constants,
+		// which would look like a result otherwise)
+		return hare.degree( ) ? hare.degree( ) : 1;
 	}
 	
-	// now we can be sure the sequence really does become periodic
-	
+	// now we can be sure the sequence really does become periodic, and
+	// lambda is the period. All the terms before the hare fit in S.
+	*mu = f2xt_find_mu( f2xt_mu_start( f, checkpoints, *lambda ), *lambda );
 	
-	// lambda is the period of the sequence. We want to find the exact
-	// point where the sequence becomes periodic.
+	// the tortoise is in the cycle
+	if( catalogue )
+		f2xt_catalogue_cycle( tortoise, *lambda, catalogue );
+	return 0;
+}
+
+
+// Once x is in the cycle and lambda is known, the latest term on
+// Nivasch's stacks which comes before the cycle, or f if there is none, as
+// in f2t_findcycles.cpp.
+template< class S >
+static S f2xt_nivasch_mu_start( const f2xt_sequence_t &f, std::vector< S > *stacks, unsigned int *sizes, S x, unsigned int lambda )
+{
+	std::vector< S > least( NIVASCH_STACKS, x );
+	bool seen[ NIVASCH_STACKS ] = { false };
+	for( unsigned int j = 0; j < lambda; j++ )
+	{
+		uint64_t h = x.hash( );
+		unsigned int c = nivasch_class( h );
+		if( !seen[ c ] || h < least[ c ].hash( ) )
+		{
+			least[ c ] = x;
+			seen[ c ] = true;
+		}
+		
+		x.step( );
+	}
 	
-	// set the tortoise at the beginning (f) and the hare lambda steps
-	// ahead. Then step both forward together one at a time until they
-	// agree
+	S *start = NULL;
+	for( unsigned int c = 0; c < NIVASCH_STACKS; c++ )
+	{
+		if( !seen[ c ] )
+			continue;
+		
+		unsigned int k = 1;
+		while( k < sizes[ c ] && stacks[ c ][ k ] != least[ c ] )
+			k++;
+		
+		if( k < sizes[ c ] && ( !start || stacks[ c ][ k - 1 ].count( ) > start->count( ) ) )
+			start = &stacks[ c ][ k - 1 ];
+	}
 	
-	tortoise = f;
-	hare = f;
+	return start ? *start : S( f );
+}
+
+
+// Nivasch's stack algorithm, after the terms up to x, as in
+// f2t_findcycles.cpp: the stacks are ordered by the hash of the terms, the
+// steps are single, and a cycle f2xt_brent wouldn't see before the
+// timeout is reported as a timeout.
+template< class S >
+static unsigned int f2xt_nivasch( const f2xt_sequence_t &f, std::vector< S > *stacks, unsigned int *sizes, S x, unsigned int deg0, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma )
+{
+	unsigned int again;		// the step at which x was seen before
+	while( 1 )
+	{
+		// the same checks on each term as in f2xt_brent (which starts at
+		// the first step)
+		if( x.count( ) )
+		{
+			if( x.is_zero( ) )
+			{
+				*mu = x.count( );
+				*lambda = 0;
+				return 0;
+			}
+			
+			if( x.count( ) >= timeout )
+			{
+				*mu = 0;
+				*lambda = 0;
+				return x.degree( ) ? x.degree( ) : 1;
+			}
+			
+			if( !*sigma && x.degree( ) < deg0 )
+				*sigma = x.count( );
+		}
+		
+		uint64_t h = x.hash( );
+		std::vector< S > &stack = stacks[ nivasch_class( h ) ];
+		unsigned int &size = sizes[ nivasch_class( h ) ];
+		while( size && stack[ size - 1 ].hash( ) > h )
+			size--;
+		
+		if( size && stack[ size - 1 ] == x )
+		{
+			again = stack[ size - 1 ].count( );
+			break;
+		}
+		
+		if( size == NIVASCH_STACK_MAX )
+		{
+			stack.erase( stack.begin( ) );
+			size--;
+		}
+		if( size < stack.size( ) )
+			stack[ size ] = x;
+		else
+			stack.push_back( x );
+		size++;
+		
+		// promote everything to a wider polynomial type if the next step
+		// won't fit, and carry on from there with the next term
+		if( !x.fits( ) )
+		{
+			typedef typename S::wider_t W;
+			std::vector< W > wider[ NIVASCH_STACKS ];
+			for( unsigned int c = 0; c < NIVASCH_STACKS; c++ )
+				for( unsigned int k = 0; k < sizes[ c ]; k++ )
+					wider[ c ].push_back( W( stacks[ c ][ k ] ) );
+			
+			W next = W( x );
+			next.step( );
+			return f2xt_nivasch( f, wider, sizes, next, deg0, timeout, mu, lambda, sigma );
+		}
+		
+		x.step( );
+	}
 	
-	// set the tortoise and hare (lambda) steps apart
-	for( unsigned int j = 1; j <= *lambda; j++ )
-		hare.step( );
+	*lambda = x.count( ) - again;
+	S start = f2xt_nivasch_mu_start( f, stacks, sizes, x, *lambda );
+	*mu = f2xt_find_mu( start, *lambda );
 	
+	// the search stops at once if start is in the cycle after all, which
+	// takes two terms with the same fingerprint; then go back to f
+	if( start.count( ) && *mu == start.count( ) )
+		*mu = f2xt_find_mu( S( f ), *lambda );
 	
-	// now iterate until they're equal
-	while( tortoise != hare )
+	// Brent's algorithm would have timed out first: stop at the same term
+	if( brent_detection_step( *mu, *lambda ) >= timeout )
 	{
-		tortoise.step( );
-		hare.step( );
+		for( unsigned int k = ( timeout - x.count( ) ) % *lambda; k; k-- )
+			x.step( );
+		
+		*mu = 0;
+		*lambda = 0;
+		return x.degree( ) ? x.degree( ) : 1;
 	}
 	
-	*mu = tortoise.count( );
 	return 0;
 }
 
 
+// start the cycle search with f stored as S, or as the first wider type
+// which can hold it
+template< class S >
+static unsigned int f2xt_findperiod_as( const f2xt_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2xt_brent_state_t *state )
+{
+	if( f.step_degree( ) > S::poly_type::max_degree )
+		return f2xt_findperiod_as< typename S::wider_t >( f, timeout, mu, lambda, sigma, detector, points, catalogue, state );
+	
+	*mu = 0;					// time to begin periodic part
+	*sigma = 0;
+	
+	if( detector == DETECT_NIVASCH )
+	{
+		std::vector< S > stacks[ NIVASCH_STACKS ];
+		unsigned int sizes[ NIVASCH_STACKS ] = { 0 };
+		S x = S( f );
+		
+		return f2xt_nivasch( f, stacks, sizes, x, x.degree( ), timeout, mu, lambda, sigma );
+	}
+	
+	S tortoise = S( f );	// tortoise
+	S hare = S( f );
+	hare.step( );			// hare	
+	
+	*lambda = 1;				// period
+	
+	std::vector< S > checkpoints;
+	
+	// current power of 2 is 1, degree of initial poly
+	unsigned int deg0 = tortoise.degree( );
+	unsigned int d = f2xt_brent( f, checkpoints, tortoise, hare, 1, deg0, timeout, mu, lambda, sigma, points, catalogue, state );
+	
+	if( points )
+		points->finish( deg0, !d, *mu, *lambda, *sigma );
+	
+	if( d && state )
+	{
+		state->f = f;
+		state->deg0 = deg0;
+	}
+	
+	return d;
+}
 
-// This function tests one polynomial using f2xt_findperiod, then outputs
-// the information in a neat row of text
-void f2xt_run_and_print( f2xt_sequence_t f, unsigned int timeout )
+
+// carry on from a saved state with the terms stored as S, or as the first
+// wider type which can hold all of them (see f2t_resume_as)
+template< class S >
+static unsigned int f2xt_resume_as( f2xt_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue )
 {
-	unsigned int mu, lambda, sigma, d;
+	if( state.maxdegree > S::poly_type::max_degree )
+		return f2xt_resume_as< typename S::wider_t >( state, timeout, mu, lambda, sigma, points, catalogue );
 	
-	f.print_short( );
+	std::vector< S > checkpoints;
+	for( unsigned int k = 0; k < state.checkpoints.size( ); k++ )
+		checkpoints.push_back( S( state.checkpoints[ k ] ) );
+	
+	*mu = 0;
+	*lambda = state.lambda;
+	*sigma = state.sigma;
 	
-	d = f2xt_findperiod( f, timeout, &mu, &lambda, &sigma );
+	// (this overwrites state if it times out again)
+	unsigned int d = f2xt_brent( state.f, checkpoints, S( state.tortoise ), S( state.hare ), state.i, state.deg0, timeout, mu, lambda, sigma, points, catalogue, &state );
 	
+	if( points )
+		points->finish( state.deg0, !d, *mu, *lambda, *sigma );
+	
+	return d;
+}
+
+
+// small polynomials start out in a single word and are promoted to 2, 4,
+// and then any number of words as they grow
+unsigned int f2xt_findperiod( const f2xt_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue, f2xt_brent_state_t *state )
+{
+	return f2xt_findperiod_as< f2xt_sequence_base_t< f2poly_fixed<1> > >( f, timeout, mu, lambda, sigma, detector, points, catalogue, state );
+}
+
+
+// the same for a saved state, going straight to the type it had got to
+unsigned int f2xt_resume( f2xt_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points, cycle_catalogue_t *catalogue )
+{
+	return f2xt_resume_as< f2xt_sequence_base_t< f2poly_fixed<1> > >( state, timeout, mu, lambda, sigma, points, catalogue );
+}
+
+
+
+// the rest of a row of output, after f
+static void f2xt_print_outcome( unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma )
+{
 	if( sigma ) printf( ", %8u", sigma );
 	else printf( ", %8s", "inf" );
 	
 	if( d ) printf( ", timeout(%u), d=%u\n", timeout, d );
 	else printf( ", %8u, %8u\n", mu, lambda );
+}
+
+
+// This function tests one polynomial using f2xt_findperiod, then outputs
+// the information in a neat row of text
+void f2xt_run_and_print( const f2xt_sequence_t &f, unsigned int timeout, cycle_detector_t detector, distinguished_points_t *points, cycle_catalogue_t *catalogue )
+{
+	unsigned int mu, lambda, sigma, d;
+	
+	f.print_short( );
+	
+	d = f2xt_findperiod( f, timeout, &mu, &lambda, &sigma, detector, points, catalogue );
 	
+	f2xt_print_outcome( timeout, d, mu, lambda, sigma );
+	
+}
+
+
+// the same row, for an outcome found some other way
+void f2xt_print_row( const f2xt_sequence_t &f, unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma )
+{
+	f.print_short( );
+	f2xt_print_outcome( timeout, d, mu, lambda, sigma );
 }
 
 
@@ -1,18 +1,50 @@
 #ifndef F2XT_FINDCYCLES_H
 #define F2XT_FINDCYCLES_H
 
+#include "cycle_catalogue.h"
+#include "cycle_detector.h"
+#include "distinguished_points.h"
 #include "f2xt_sequence.h"
 #include <cstdint>
-
-// find cycle in sequence starting at f using Brent's algorithm
+#include <vector>
+
+
+// Where Brent's algorithm had got to on a trajectory when it timed out,
+// as for f2t_brent_state_t
+struct f2xt_brent_state_t
+{
+	f2xt_sequence_t f;
+	std::vector< f2xt_sequence_t > checkpoints;
+	f2xt_sequence_t tortoise, hare;
+	unsigned int i, deg0, lambda, sigma, maxdegree;
+};
+
+// find cycle in sequence starting at f using Brent's algorithm, or the
+// one picked by detector (see cycle_detector.h). With points, Brent's
+// algorithm stops early at distinguished points that earlier trajectories
+// have been through (see distinguished_points.h), and with catalogue,
+// once it is in a cycle found before, whose new cycles it adds (see
+// cycle_catalogue.h). If Brent's algorithm times out and state isn't NULL,
+// where it got to is saved there.
 // mu is the number of iterations until it becomces periodic
 // lambda is the length of the period
+// sigma is the stopping time
 // returns 0 unless the iteration times out, in which case it
 // returns the degree where it stopped
-unsigned int f2xt_findperiod( f2xt_sequence_t f, unsigned int timeout, unsigned int *mu, unsigned int *lambda );
+unsigned int f2xt_findperiod( const f2xt_sequence_t &f, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, cycle_detector_t detector = DETECT_BRENT, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL, f2xt_brent_state_t *state = NULL );
+
+
+// Carry on with Brent's algorithm from a saved state, up to a bigger
+// timeout: the outcome is the same as from f2xt_findperiod with that
+// timeout. If it times out again, state is updated.
+unsigned int f2xt_resume( f2xt_brent_state_t &state, unsigned int timeout, unsigned int *mu, unsigned int *lambda, unsigned int *sigma, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL );
+
 
+void f2xt_run_and_print( const f2xt_sequence_t &f, unsigned int timeout, cycle_detector_t detector = DETECT_BRENT, distinguished_points_t *points = NULL, cycle_catalogue_t *catalogue = NULL );
 
-void f2xt_run_and_print( f2xt_sequence_t f, unsigned int timeout );
+// the same row for an outcome already found (d is the degree at the
+// timeout, or 0)
+void f2xt_print_row( const f2xt_sequence_t &f, unsigned int timeout, unsigned int d, unsigned int mu, unsigned int lambda, unsigned int sigma );
 
 
 
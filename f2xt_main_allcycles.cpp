@@ -15,49 +15,341 @@
  * 
  * F2XT_Q		quotient polynomial; ring is F_2[x,t] / (x^2 + tx + q(t))
  * 
- * (all stored as bits in a long, i.e. the k-th bit is the coefficient of t^k)
+ * (all stored in binary form, i.e. the k-th bit is the coefficient of t^k;
+ * wide values can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
  * 
- * Command line arguments: < b0, b1, n, timeout >
+ * Optionally, F2XT_JUMP sets k for the k-step jump table used by the cycle
+ * search (0 for single steps only, default 6; k is capped so that the
+ * table entries fit in a word, see f2xt_sequence.h)
+ * 
+ * F2XT_DETECTOR picks the cycle detection algorithm, brent (the default) or
+ * nivasch (see cycle_detector.h). nivasch takes single steps and ignores
+ * F2XT_JUMP and F2XT_DP_BITS to F2XT_SLICES below, with a warning if they
+ * are set.
+ * 
+ * F2XT_DP_BITS, if set to k > 0, lets Brent's algorithm stop at terms whose
+ * hash ends in k zero bits once an earlier input in the block has been
+ * through them, and take sigma, mu and lambda from there (see
+ * distinguished_points.h). The output is the same.
+ * 
+ * F2XT_CATALOGUE names a file of the cycles found so far for this map,
+ * shared between runs: Brent's algorithm stops as soon as a trajectory
+ * enters one of them, and adds the new ones (see cycle_catalogue.h). The
+ * output is the same.
+ * 
+ * F2XT_ESCALATE, if set to s > 0, first runs every input in a tile for at
+ * most s steps, and then carries on with the ones which timed out from
+ * where Brent's algorithm got to, for 2s steps, 4s, and so on up to the
+ * timeout (as F2T_ESCALATE in f2t_main_allcycles). The output is the same.
+ * 
+ * F2XT_SLICES, if set to 1, runs Brent's algorithm on 64 inputs at once
+ * (256 or 512 with AVX2 or AVX-512), bit-sliced, for as long as they stay
+ * small (see f2xt_slices.h). Set to generic, avx2 or avx512, it also picks
+ * the kernel. The output is the same.
+ * 
+ * F2XT_THREADS sets the number of threads (default: one per core). The
+ * block is cut into square tiles, which are handed out to the threads in
+ * order; the rows are printed tile by tile, in order, as they are done.
+ * The threads share the distinguished points, and each has its own view
+ * of the catalogue.
+ * 
+ * Command line arguments: < b0, b1, n0, timeout > [ n1, tile ]
  * 		b0, b1: initial polynomial f = b0 + xb1
- * 		n: block width
- * 			(i.e. check f0 + f1x for n choices of f0 and n choices of f1)
+ * 		n0, n1: block size
+ * 			(i.e. check f0 + f1x for n0 choices of f0 and n1 choices of f1;
+ * 			n1 is n0 unless given)
  * 		timeout: maximum number of steps to calculate for each trajectory
+ * 		tile: side of the tiles (default 32)
  * 
  */
 
 
 #include "f2xt_sequence.h"
 #include "f2xt_findcycles.h"
+#include "f2xt_slices.h"
 #include <cstdlib>
+#include <cstring>
 #include <cstdio>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// side of the tiles unless given
+#define TILE_DEFAULT 32
+
+
+// what happened to one input
+struct outcome_t
+{
+	unsigned int d, mu, lambda, sigma;
+};
+
+
+// what each thread has to itself
+struct worker_t
+{
+	f2xt_sequence_t f;
+	distinguished_points_t *points;
+	cycle_catalogue_t *catalogue;
+	f2xt_slices_t *slices;
+	
+	std::map< unsigned int, unsigned int > rounds;	// inputs which went on past each budget
+	
+	worker_t( const f2xt_sequence_t &f ) : f( f ), points( NULL ), catalogue( NULL ), slices( NULL ) { }
+	~worker_t( ) { delete points; delete catalogue; delete slices; }
+};
+
+
+// the block, and how far the threads have got with it
+struct block_t
+{
+	uint64_t b0, b1;			// the inputs are b0 + xb1 to b0 + n0 - 1 + x( b1 + n1 - 1 )
+	unsigned int n0, n1, tile, timeout, escalate, threads;
+	cycle_detector_t detector;
+	
+	unsigned int tiles0, tiles1;	// number of tiles each way
+	
+	std::mutex lock;
+	unsigned int next;			// first tile not handed out yet
+	unsigned int printed;		// first tile not printed yet
+	std::map< unsigned int, std::vector< outcome_t > > finished;	// tiles waiting to be printed
+};
+
+
+// the corner and size of tile t
+static void tile_bounds( const block_t &b, unsigned int t, unsigned int *j0, unsigned int *i0, unsigned int *m0, unsigned int *m1 )
+{
+	*j0 = t / b.tiles1 * b.tile;
+	*i0 = t % b.tiles1 * b.tile;
+	*m0 = b.n0 - *j0 < b.tile ? b.n0 - *j0 : b.tile;
+	*m1 = b.n1 - *i0 < b.tile ? b.n1 - *i0 : b.tile;
+}
 
 
-// initialize starting polynomial with l words, all 0 except most significant (top)
-// start there, and do n consecutive polynoimals
-void findperiod_loop( uint64_t m0, uint64_t m1, uint64_t a0, uint64_t a1, uint64_t q, uint64_t b0, uint64_t b1, unsigned int n0, unsigned int n1, unsigned int timeout )
+// run input k of a tile, which is in w.f, up to budget; if that is short
+// of the timeout and it times out, it is kept in survivors
+static void run_input( block_t &b, worker_t &w, unsigned int k, outcome_t &o, unsigned int budget, std::vector< std::pair< unsigned int, f2xt_brent_state_t > > &survivors )
 {
-	f2xt_sequence_t f = f2xt_sequence_t( m0, m1, a0, a1, q );
-	f.setpolys( 1, b0, 1, b1 );
+	f2xt_brent_state_t state;
+	o.d = f2xt_findperiod( w.f, budget, &o.mu, &o.lambda, &o.sigma, b.detector, w.points, w.catalogue, budget < b.timeout ? &state : NULL );
 	
-	printf( "\nusing multiplier %lu + x %lu \n", m0, m1 );
-	printf( "calculating periods for %u x %u block of inputs,\n", n0, n1 );
+	if( o.d && budget < b.timeout )
+		survivors.push_back( std::make_pair( k, std::move( state ) ) );
+}
+
+
+// run the inputs in tile t, row by row
+static void run_tile( block_t &b, worker_t &w, unsigned int t, std::vector< outcome_t > &out )
+{
+	unsigned int j0, i0, m0, m1;
+	tile_bounds( b, t, &j0, &i0, &m0, &m1 );
+	out.resize( m0 * m1 );
+	
+	// with escalation, the first pass only goes up to the smallest budget,
+	// and the inputs which time out are kept for later
+	unsigned int budget = b.escalate && b.escalate < b.timeout ? b.escalate : b.timeout;
+	std::vector< std::pair< unsigned int, f2xt_brent_state_t > > survivors;
+	
+	if( !w.slices )
+	{
+		for( unsigned int k = 0; k < out.size( ); k++ )
+		{
+			w.f.setpolys( 1, b.b0 + j0 + k / m1, 1, b.b1 + i0 + k % m1 );
+			run_input( b, w, k, out[ k ], budget, survivors );
+		}
+	}
+	else
+	{
+		// the lanes hand back the inputs they can't finish: those too big
+		// for them are run as usual, and the others carry on from where
+		// they got to
+		std::vector< std::pair< uint64_t, uint64_t > > starts;
+		for( unsigned int k = 0; k < out.size( ); k++ )
+			starts.push_back( std::make_pair( b.b0 + j0 + k / m1, b.b1 + i0 + k % m1 ) );
+		
+		std::vector< f2xt_slices_result_t > results;
+		std::vector< std::pair< unsigned int, f2xt_brent_state_t > > states;
+		w.slices->run( starts, budget, budget < b.timeout, results, states );
+		
+		for( unsigned int k = 0; k < out.size( ); k++ )
+		{
+			outcome_t &o = out[ k ];
+			o.d = results[ k ].d;
+			o.mu = results[ k ].mu;
+			o.lambda = results[ k ].lambda;
+			o.sigma = results[ k ].sigma;
+			
+			if( results[ k ].status == SLICES_SKIPPED )
+			{
+				w.f.setpolys( 1, starts[ k ].first, 1, starts[ k ].second );
+				run_input( b, w, k, o, budget, survivors );
+			}
+		}
+		
+		for( unsigned int j = 0; j < states.size( ); j++ )
+		{
+			unsigned int k = states[ j ].first;
+			outcome_t &o = out[ k ];
+			if( results[ k ].status == SLICES_RESUME )
+				o.d = f2xt_resume( states[ j ].second, budget, &o.mu, &o.lambda, &o.sigma, w.points, w.catalogue );
+			
+			if( o.d && budget < b.timeout )
+				survivors.push_back( std::make_pair( k, std::move( states[ j ].second ) ) );
+		}
+	}
+	
+	// then the ones which timed out carry on from where they got to, with
+	// the budget doubling each time, until it reaches the timeout
+	while( !survivors.empty( ) )
+	{
+		w.rounds[ budget ] += survivors.size( );
+		budget = budget < b.timeout / 2 ? 2 * budget : b.timeout;
+		
+		unsigned int kept = 0;
+		for( unsigned int j = 0; j < survivors.size( ); j++ )
+		{
+			outcome_t &o = out[ survivors[ j ].first ];
+			o.d = f2xt_resume( survivors[ j ].second, budget, &o.mu, &o.lambda, &o.sigma, w.points, w.catalogue );
+			
+			if( o.d && budget < b.timeout )
+			{
+				if( kept < j )
+					survivors[ kept ] = std::move( survivors[ j ] );
+				kept++;
+			}
+		}
+		
+		survivors.resize( kept );
+	}
+}
+
+
+// print the rows for tile t
+static void print_tile( block_t &b, worker_t &w, unsigned int t, const std::vector< outcome_t > &out )
+{
+	unsigned int j0, i0, m0, m1;
+	tile_bounds( b, t, &j0, &i0, &m0, &m1 );
+	
+	for( unsigned int k = 0; k < out.size( ); k++ )
+	{
+		const outcome_t &o = out[ k ];
+		w.f.setpolys( 1, b.b0 + j0 + k / m1, 1, b.b1 + i0 + k % m1 );
+		f2xt_print_row( w.f, b.timeout, o.d, o.mu, o.lambda, o.sigma );
+	}
+}
+
+
+// one thread: take tiles until there are none left, and print the
+// finished ones in order (as in f2t_main_allcycles)
+static void findperiod_worker( block_t *b, worker_t *w )
+{
+	std::unique_lock< std::mutex > guard( b->lock );
+	
+	while( b->next < b->tiles0 * b->tiles1 )
+	{
+		unsigned int t = b->next++;
+		
+		guard.unlock( );
+		std::vector< outcome_t > out;
+		run_tile( *b, *w, t, out );
+		guard.lock( );
+		
+		b->finished[ t ].swap( out );
+		while( !b->finished.empty( ) && b->finished.begin( )->first == b->printed )
+		{
+			print_tile( *b, *w, b->printed, b->finished.begin( )->second );
+			b->finished.erase( b->finished.begin( ) );
+			b->printed++;
+		}
+		fflush( stdout );
+	}
+}
+
+
+// run the n0 x n1 block of inputs starting at b0 + xb1
+void findperiod_loop( f2poly_t m0, f2poly_t m1, f2poly_t a0, f2poly_t a1, f2poly_t q, block_t &b, std::vector< worker_t* > &workers, unsigned int bits )
+{
+	f2xt_sequence_t &f = workers[ 0 ]->f;
+	f.setpolys( 1, b.b0, 1, b.b1 );
+	
+	printf( "\nusing multiplier " );
+	m0.printdec( );
+	printf( " + x " );
+	m1.printdec( );
+	printf( " \n" );
+	printf( "using multiply kernel %s\n", f2poly_kernel_name( ) );
+	printf( "using step kernels " );
+	f2xt_sequence_base_t< f2poly_fixed<4> >( m0, m1, a0, a1, q ).print_kernels( );
+	printf( " (" );
+	f.print_kernels( );
+	printf( " beyond 4 words)\n" );
+	if( f.jump_steps( ) )
+		printf( "using %u-step jumps\n", f.jump_steps( ) );
+	printf( "using cycle detector %s\n", cycle_detector_name( b.detector ) );
+	printf( "using %u threads, %u x %u tiles\n", b.threads, b.tile, b.tile );
+	if( workers[ 0 ]->points )
+		printf( "using distinguished points with %u zero bits\n", bits );
+	if( workers[ 0 ]->catalogue )
+		printf( "using cycle catalogue with %zu cycles\n", workers[ 0 ]->catalogue->size( ) );
+	if( b.escalate )
+		printf( "using step budgets from %u, doubling up to the timeout\n", b.escalate );
+	if( workers[ 0 ]->slices )
+		printf( "using bit-sliced engine %s with %u lanes\n", workers[ 0 ]->slices->kernel_name( ), workers[ 0 ]->slices->lane_count( ) );
+	printf( "calculating periods for %u x %u block of inputs,\n", b.n0, b.n1 );
 	printf( "starting at " );
 	f.print_short( );
 	printf( "\n%5s, %8s, %8s, %8s\n", "f", "sigma", "mu", "lambda" );
+	fflush( stdout );
 	
-	for( unsigned int j = 1; j <= n0; j++ )
+	b.tiles0 = ( b.n0 + b.tile - 1 ) / b.tile;
+	b.tiles1 = ( b.n1 + b.tile - 1 ) / b.tile;
+	b.next = 0;
+	b.printed = 0;
+	
+	std::vector< std::thread > threads;
+	for( unsigned int t = 1; t < b.threads; t++ )
+		threads.push_back( std::thread( findperiod_worker, &b, workers[ t ] ) );
+	findperiod_worker( &b, workers[ 0 ] );
+	for( unsigned int t = 0; t < threads.size( ); t++ )
+		threads[ t ].join( );
+	
+	// the statistics, added up over the threads
+	unsigned int merged = 0, hits = 0, added = 0, sliced = 0, handed = 0;
+	std::map< unsigned int, unsigned int > rounds;
+	for( unsigned int t = 0; t < b.threads; t++ )
 	{
-		uint64_t b1copy = b1;
-		for( unsigned int i = 1; i <= n1; i++ )
-		{	
-			f.setpolys( 1, b0, 1, b1copy++ );
-			
-			f2xt_run_and_print( f, timeout );
+		worker_t &w = *workers[ t ];
+		if( w.points )
+			merged += w.points->merged;
+		if( w.catalogue )
+		{
+			hits += w.catalogue->hits;
+			added += w.catalogue->added;
 		}
-		b0++;
-		
+		if( w.slices )
+		{
+			sliced += w.slices->finished;
+			handed += w.slices->handed;
+		}
+		for( std::map< unsigned int, unsigned int >::iterator it = w.rounds.begin( ); it != w.rounds.end( ); it++ )
+			rounds[ it->first ] += it->second;
 	}
+	
+	for( std::map< unsigned int, unsigned int >::iterator it = rounds.begin( ); it != rounds.end( ); it++ )
+		printf( "escalation: %u inputs went on past %u steps\n", it->second, it->first );
+	if( workers[ 0 ]->points )
+		printf( "distinguished points: merged %u of %u inputs, %zu points kept\n",
+			merged, b.n0 * b.n1, workers[ 0 ]->points->size( ) );
+	if( workers[ 0 ]->catalogue )
+		printf( "cycle catalogue: %u inputs entered known cycles, %u new cycles added\n",
+			hits, added );
+	if( workers[ 0 ]->slices )
+		printf( "bit-sliced: %u of %u inputs finished in the lanes, %u handed back\n", sliced, b.n0 * b.n1, handed );
 }
 
 
@@ -81,23 +373,99 @@ int main( int argc, char **argv )
 		return 1;
 	}
 	
-	uint64_t m0 = strtoul( env_F2XT_M0, NULL, 0 );
-	uint64_t m1 = strtoul( env_F2XT_M1, NULL, 0 );
-	uint64_t a0 = strtoul( env_F2XT_A0, NULL, 0 );
-	uint64_t a1 = strtoul( env_F2XT_A1, NULL, 0 );
-	uint64_t q = strtoul( env_F2XT_Q, NULL, 0 );
+	f2poly_t m0 = f2poly_parse( env_F2XT_M0 );
+	f2poly_t m1 = f2poly_parse( env_F2XT_M1 );
+	f2poly_t a0 = f2poly_parse( env_F2XT_A0 );
+	f2poly_t a1 = f2poly_parse( env_F2XT_A1 );
+	f2poly_t q = f2poly_parse( env_F2XT_Q );
 	
+	block_t b;
+	if( !cycle_detector_parse( getenv( "F2XT_DETECTOR" ), &b.detector ) )
+	{
+		printf( "Error: unknown cycle detector %s.\n", getenv( "F2XT_DETECTOR" ) );
+		return 1;
+	}
+	bool brent = b.detector == DETECT_BRENT;
 	
-	uint64_t b0 = strtoul( argv[ 1 ], NULL, 0 );
-	uint64_t b1 = strtoul( argv[ 2 ], NULL, 0 );
-	unsigned int n = strtoul( argv[ 3 ], NULL, 0 );
-	unsigned int timeout = strtoul( argv[ 4 ], NULL, 0 );
+	const char *const brent_only[ ] = { "F2XT_JUMP", "F2XT_DP_BITS", "F2XT_CATALOGUE", "F2XT_ESCALATE", "F2XT_SLICES", NULL };
+	cycle_detector_ignored( b.detector, brent_only );
 	
-	unsigned int n0 = n;
-	unsigned int n1 = n;
+	char *env_F2XT_JUMP = getenv( "F2XT_JUMP" );
+	unsigned int k = env_F2XT_JUMP ? strtoul( env_F2XT_JUMP, NULL, 0 ) : F2XT_JUMP_DEFAULT;
 	
+	char *env_F2XT_DP_BITS = getenv( "F2XT_DP_BITS" );
+	unsigned int bits = env_F2XT_DP_BITS ? strtoul( env_F2XT_DP_BITS, NULL, 0 ) : 0;
+	if( bits > 63 )
+		bits = 63;
 	
-	findperiod_loop( m0, m1, a0, a1, q, b0, b1, n0, n1, timeout );
-
+	char *env_F2XT_ESCALATE = getenv( "F2XT_ESCALATE" );
+	b.escalate = env_F2XT_ESCALATE && brent ? strtoul( env_F2XT_ESCALATE, NULL, 0 ) : 0;
+	
+	char *env_F2XT_SLICES = getenv( "F2XT_SLICES" );
+	bool sliced = brent && env_F2XT_SLICES && strcmp( env_F2XT_SLICES, "0" )
+		&& f2xt_slices_t::supported( f2xt_sequence_t( m0, m1, a0, a1, q ) );
+	
+	char *env_F2XT_THREADS = getenv( "F2XT_THREADS" );
+	b.threads = env_F2XT_THREADS ? strtoul( env_F2XT_THREADS, NULL, 0 ) : std::thread::hardware_concurrency( );
+	if( !b.threads )
+		b.threads = 1;
+	
+	
+	b.b0 = strtoul( argv[ 1 ], NULL, 0 );
+	b.b1 = strtoul( argv[ 2 ], NULL, 0 );
+	b.n0 = strtoul( argv[ 3 ], NULL, 0 );
+	b.timeout = strtoul( argv[ 4 ], NULL, 0 );
+	
+	b.n1 = argc > 5 ? strtoul( argv[ 5 ], NULL, 0 ) : b.n0;
+	b.tile = argc > 6 ? strtoul( argv[ 6 ], NULL, 0 ) : TILE_DEFAULT;
+	if( !b.tile )
+		b.tile = TILE_DEFAULT;
+	
+	
+	// (only Brent's algorithm uses them.) The catalogue is for the map
+	// given by all five polynomials, each as its number of words and then
+	// the words
+	char *env_F2XT_CATALOGUE = getenv( "F2XT_CATALOGUE" );
+	std::vector< uint64_t > params;
+	const f2poly_t *polys[ 5 ] = { &m0, &m1, &a0, &a1, &q };
+	for( unsigned int k = 0; k < 5; k++ )
+	{
+		std::vector< uint64_t > w = polys[ k ]->wordvector( );
+		params.push_back( w.size( ) );
+		params.insert( params.end( ), w.begin( ), w.end( ) );
+	}
+	
+	std::vector< worker_t* > workers;
+	int status = 0;
+	for( unsigned int t = 0; t < b.threads && !status; t++ )
+	{
+		worker_t *w = new worker_t( f2xt_sequence_t( m0, m1, a0, a1, q ) );
+		workers.push_back( w );
+		w->f.set_jump( brent ? k : 0 );
+		
+		if( sliced )
+			w->slices = new f2xt_slices_t( m0, m1, a0, a1, q, k, strcmp( env_F2XT_SLICES, "1" ) ? env_F2XT_SLICES : NULL );
+		
+		// (the first thread's distinguished points are shared with the
+		// others)
+		if( bits && brent )
+			w->points = t ? new distinguished_points_t( *workers[ 0 ]->points ) : new distinguished_points_t( bits );
+		
+		// (the catalogue can be opened more than once; it is locked for
+		// each of them)
+		if( env_F2XT_CATALOGUE && brent )
+		{
+			w->catalogue = new cycle_catalogue_t( );
+			if( !w->catalogue->open( env_F2XT_CATALOGUE, params ) )
+				status = 1;
+		}
+	}
+	
+	if( !status )
+		findperiod_loop( m0, m1, a0, a1, q, b, workers, bits );
+	
+	for( unsigned int t = 0; t < workers.size( ); t++ )
+		delete workers[ t ];
 	
+	return status;
 }
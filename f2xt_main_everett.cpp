@@ -0,0 +1,369 @@
+/* f2xt_main_everett
+ * 
+ * This program measures the stopping times of the mx+1 map on the
+ * elements of F_2[x,t]/(x^2+tx+q(t)) of a given degree d (that is, with
+ * max( deg f0, deg f1 ) = d), in the spirit of Everett's density result
+ * for the 3x+1 map: for each start f it counts the steps to the first term
+ * of lower degree than f (sigma in f2xt_main_allcycles), and stops there,
+ * with no cycle search. The output is the fraction F( s ) of starts which
+ * have dropped within s steps, for each s where it changes, with 95%
+ * confidence bounds when the starts are a random sample.
+ * 
+ * Parameters for the mx+1 map is specified as an environment variable:
+ * F2XT_M0		multiplier m = m0 + xm1
+ * F2XT_M1
+ * 
+ * F2XT_A0		adjustment a = a0 + xa1
+ * F2XT_A1
+ * 
+ * F2XT_Q		quotient polynomial; ring is F_2[x,t] / (x^2 + tx + q(t))
+ * 
+ * (all stored in binary form, i.e. the k-th bit is the coefficient of t^k;
+ * wide values can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
+ * 
+ * Optionally, F2XT_JUMP sets k for the k-step jump table (0 for single
+ * steps only, default 6, see f2xt_sequence.h); a jump is only taken when
+ * none of the terms it skips can be of lower degree than the start, so the
+ * stopping times are the same.
+ * 
+ * F2XT_THREADS sets the number of threads (default: one per core). The
+ * starts are handed out to the threads in chunks, and each thread counts
+ * the stopping times of its own; the counts are added up at the end, so
+ * the output doesn't depend on the number of threads.
+ * 
+ * Command line arguments: < d, timeout > [ samples, seed ]
+ * 		d: degree of the starts (1 to 63)
+ * 		timeout: maximum number of steps to calculate for each trajectory
+ * 			(below 2^32 - 1)
+ * 		samples: number of random starts, drawn uniformly from the 3*4^d
+ * 			of degree d; 0 or not given for all of them (d up to 30)
+ * 		seed: for the random starts (default 0)
+ * 
+ */
+
+
+#include "f2xt_sequence.h"
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// starts handed out to a thread at a time
+#define CHUNK 4096
+
+// largest d for which all the starts can be run
+#define ENUMERATE_MAX 30
+
+// the normal quantile for the confidence bounds (95%, two-sided)
+#define CONFIDENCE_Z 1.96
+
+
+// what each thread has to itself
+struct worker_t
+{
+	f2xt_sequence_t f;							// for the starts too big for small
+	f2xt_sequence_base_t< f2poly_fixed<1> > small;	// for those with one word terms
+	
+	// starts with each stopping time (only up to the largest seen so far,
+	// which is usually far below the timeout), and those not stopped by
+	// the timeout
+	std::vector< uint64_t > stopped;
+	uint64_t censored;
+	
+	worker_t( const f2xt_sequence_t &f ) : f( f ), small( f ), censored( 0 ) { }
+};
+
+
+// the starts, and how far the threads have got with them
+struct starts_t
+{
+	unsigned int d, timeout, threads;
+	uint64_t n;					// number of starts
+	uint64_t samples, seed;		// random starts, if samples > 0
+	
+	std::mutex lock;
+	uint64_t next;				// first start not handed out yet
+};
+
+
+// splitmix64: the next word of the stream with state s
+static uint64_t splitmix64( uint64_t &s )
+{
+	uint64_t z = ( s += 0x9e3779b97f4a7c15 );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
+	return z ^ ( z >> 31 );
+}
+
+
+// start j, as b0 + xb1: with all the starts, its top bits (t^d in b0, b1
+// or both) are j / 4^d and the rest of b0 and b1 the two halves of
+// j % 4^d; random start j is made of words 3j to 3j + 2 of the splitmix64
+// stream from the seed, so that it doesn't depend on which thread runs it
+static void start_polys( const starts_t &s, uint64_t j, uint64_t *b0, uint64_t *b1 )
+{
+	uint64_t low = ( (uint64_t) 1 << s.d ) - 1;
+	uint64_t top, w0, w1;
+	
+	if( s.samples )
+	{
+		uint64_t state = s.seed + 3 * j * 0x9e3779b97f4a7c15;
+		w0 = splitmix64( state );
+		w1 = splitmix64( state );
+		top = splitmix64( state ) % 3;	// (the bias is below 2^-62)
+	}
+	else
+	{
+		w0 = j;
+		w1 = ( j >> s.d );
+		top = j >> ( 2 * s.d );
+	}
+	
+	*b0 = ( w0 & low ) | ( ( ( top + 1 ) & 1 ) << s.d );
+	*b1 = ( w1 & low ) | ( ( ( top + 1 ) >> 1 ) << s.d );
+}
+
+
+// the stopping time of x: the number of steps to the first term of degree
+// < deg0, or timeout + 1 if it doesn't get there. Jumps are taken only when
+// jump_low( ) shows that the terms they skip all have degree >= deg0, so
+// the first one of lower degree is never skipped; x is promoted to the
+// next wider type as soon as it stops fitting
+template< class S >
+static unsigned int stopping_time( S &x, unsigned int deg0, unsigned int timeout )
+{
+	unsigned int k = x.jump_steps( );
+	
+	while( x.degree( ) >= deg0 )
+	{
+		if( x.count( ) >= timeout )
+			return timeout + 1;
+		
+		if( !x.fits( ) )
+		{
+			typename S::wider_t y( x );
+			return stopping_time( y, deg0, timeout );
+		}
+		
+		if( k && k <= timeout - x.count( ) && x.jump_fits( ) && x.jump_low( ) >= deg0 )
+			x.step_k( );
+		else
+			x.step( );
+	}
+	
+	return x.count( );
+}
+
+
+// the stopping time of f, stored as S or as the first wider type which can
+// hold it (as f2xt_findperiod_as)
+template< class S >
+static unsigned int stopping_time_as( const f2xt_sequence_t &f, unsigned int timeout )
+{
+	if( f.step_degree( ) > S::poly_type::max_degree )
+		return stopping_time_as< typename S::wider_t >( f, timeout );
+	
+	S x = S( f );
+	return stopping_time( x, x.degree( ), timeout );
+}
+
+
+// one thread: take chunks of starts until there are none left
+static void everett_worker( starts_t *s, worker_t *w )
+{
+	std::unique_lock< std::mutex > guard( s->lock );
+	
+	while( s->next < s->n )
+	{
+		uint64_t j0 = s->next;
+		uint64_t j1 = s->n - j0 < CHUNK ? s->n : j0 + CHUNK;
+		s->next = j1;
+		guard.unlock( );
+		
+		for( uint64_t j = j0; j < j1; j++ )
+		{
+			uint64_t b0, b1;
+			start_polys( *s, j, &b0, &b1 );
+			
+			// the one word type is kept, rather than converted for every
+			// start, whenever it can hold the start
+			unsigned int sigma;
+			w->small.setpolys( 1, b0, 1, b1 );
+			if( w->small.fits( ) )
+				sigma = stopping_time( w->small, s->d, s->timeout );
+			else
+			{
+				w->f.setpolys( 1, b0, 1, b1 );
+				sigma = stopping_time_as< f2xt_sequence_base_t< f2poly_fixed<2> > >( w->f, s->timeout );
+			}
+			
+			if( sigma > s->timeout )
+				w->censored++;
+			else
+			{
+				if( sigma >= w->stopped.size( ) )
+					w->stopped.resize( sigma + 1, 0 );
+				w->stopped[ sigma ]++;
+			}
+		}
+		
+		guard.lock( );
+	}
+}
+
+
+// the Wilson score interval for a proportion of c out of n
+static void wilson_bounds( uint64_t c, uint64_t n, double *lo, double *hi )
+{
+	double p = (double) c / n, z2 = CONFIDENCE_Z * CONFIDENCE_Z / n;
+	double centre = ( p + z2 / 2 ) / ( 1 + z2 );
+	double half = CONFIDENCE_Z * sqrt( p * ( 1 - p ) / n + z2 / ( 4 * n ) ) / ( 1 + z2 );
+	
+	*lo = centre - half > 0 ? centre - half : 0;
+	*hi = centre + half < 1 ? centre + half : 1;
+}
+
+
+// run the starts and print the stopping time density
+void everett_loop( f2poly_t m0, f2poly_t m1, starts_t &s, std::vector< worker_t* > &workers )
+{
+	printf( "\nusing multiplier " );
+	m0.printdec( );
+	printf( " + x " );
+	m1.printdec( );
+	printf( " \n" );
+	if( workers[ 0 ]->f.jump_steps( ) )
+		printf( "using %u-step jumps\n", workers[ 0 ]->f.jump_steps( ) );
+	printf( "using %u threads\n", s.threads );
+	if( s.samples )
+		printf( "measuring stopping times for %lu random inputs of degree %u (seed %lu),\n", s.n, s.d, s.seed );
+	else
+		printf( "measuring stopping times for all %lu inputs of degree %u,\n", s.n, s.d );
+	printf( "up to %u steps\n", s.timeout );
+	printf( "%8s, %12s, %10s, %10s, %10s\n", "steps", "stopped", "fraction", "low", "high" );
+	fflush( stdout );
+	
+	s.next = 0;
+	
+	std::vector< std::thread > threads;
+	for( unsigned int t = 1; t < s.threads; t++ )
+		threads.push_back( std::thread( everett_worker, &s, workers[ t ] ) );
+	everett_worker( &s, workers[ 0 ] );
+	for( unsigned int t = 0; t < threads.size( ); t++ )
+		threads[ t ].join( );
+	
+	// the counts, added up over the threads
+	std::vector< uint64_t > stopped;
+	uint64_t censored = 0;
+	for( unsigned int t = 0; t < s.threads; t++ )
+	{
+		worker_t &w = *workers[ t ];
+		if( w.stopped.size( ) > stopped.size( ) )
+			stopped.resize( w.stopped.size( ), 0 );
+		for( size_t k = 0; k < w.stopped.size( ); k++ )
+			stopped[ k ] += w.stopped[ k ];
+		censored += w.censored;
+	}
+	
+	// the cumulative counts; with all the starts the fraction is exact
+	uint64_t total = 0;
+	for( unsigned int k = 0; k < stopped.size( ); k++ )
+	{
+		if( !stopped[ k ] )
+			continue;
+		
+		total += stopped[ k ];
+		double fraction = (double) total / s.n, lo = fraction, hi = fraction;
+		if( s.samples )
+			wilson_bounds( total, s.n, &lo, &hi );
+		
+		printf( "%8u, %12lu, %10.6f, %10.6f, %10.6f\n", k, total, fraction, lo, hi );
+	}
+	
+	printf( "not stopped within %u steps: %lu of %lu inputs\n", s.timeout, censored, s.n );
+}
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 3 )
+	{
+		printf( "not enough arguments\n" );
+		return 0;
+	}
+	
+	char *env_F2XT_M0 = getenv( "F2XT_M0" );
+	char *env_F2XT_M1 = getenv( "F2XT_M1" );
+	char *env_F2XT_A0 = getenv( "F2XT_A0" );
+	char *env_F2XT_A1 = getenv( "F2XT_A1" );
+	char *env_F2XT_Q = getenv( "F2XT_Q" );
+	if( env_F2XT_M0 == NULL || env_F2XT_M1 == NULL || env_F2XT_A0 == NULL
+	|| env_F2XT_A1 == NULL || env_F2XT_Q == NULL )
+	{
+		printf( "Error: environment variable(s) undefined.\n" );
+		return 1;
+	}
+	
+	f2poly_t m0 = f2poly_parse( env_F2XT_M0 );
+	f2poly_t m1 = f2poly_parse( env_F2XT_M1 );
+	f2poly_t a0 = f2poly_parse( env_F2XT_A0 );
+	f2poly_t a1 = f2poly_parse( env_F2XT_A1 );
+	f2poly_t q = f2poly_parse( env_F2XT_Q );
+	
+	char *env_F2XT_JUMP = getenv( "F2XT_JUMP" );
+	unsigned int k = env_F2XT_JUMP ? strtoul( env_F2XT_JUMP, NULL, 0 ) : F2XT_JUMP_DEFAULT;
+	
+	starts_t s;
+	
+	char *env_F2XT_THREADS = getenv( "F2XT_THREADS" );
+	s.threads = env_F2XT_THREADS ? strtoul( env_F2XT_THREADS, NULL, 0 ) : std::thread::hardware_concurrency( );
+	if( !s.threads )
+		s.threads = 1;
+	
+	
+	s.d = strtoul( argv[ 1 ], NULL, 0 );
+	unsigned long timeout = strtoul( argv[ 2 ], NULL, 0 );
+	s.samples = argc > 3 ? strtoull( argv[ 3 ], NULL, 0 ) : 0;
+	s.seed = argc > 4 ? strtoull( argv[ 4 ], NULL, 0 ) : 0;
+	
+	if( s.d < 1 || s.d >= WORDLENGTH )
+	{
+		printf( "Error: the degree has to be from 1 to %u.\n", WORDLENGTH - 1 );
+		return 1;
+	}
+	if( !s.samples && s.d > ENUMERATE_MAX )
+	{
+		printf( "Error: too many inputs of degree %u; give a number of samples.\n", s.d );
+		return 1;
+	}
+	// (a start which doesn't stop counts as timeout + 1, which has to fit)
+	if( timeout >= UINT_MAX )
+	{
+		printf( "Error: the timeout has to be below %u.\n", UINT_MAX );
+		return 1;
+	}
+	s.timeout = timeout;
+	s.n = s.samples ? s.samples : (uint64_t) 3 << ( 2 * s.d );
+	
+	
+	std::vector< worker_t* > workers;
+	for( unsigned int t = 0; t < s.threads; t++ )
+	{
+		f2xt_sequence_t f( m0, m1, a0, a1, q );
+		f.set_jump( k );
+		workers.push_back( new worker_t( f ) );
+	}
+	
+	everett_loop( m0, m1, s, workers );
+	
+	for( unsigned int t = 0; t < workers.size( ); t++ )
+		delete workers[ t ];
+	
+	return 0;
+}
@@ -12,7 +12,9 @@
  * 
  * F2XT_Q		quotient polynomial; ring is F_2[x,t] / (x^2 + tx + q(t))
  * 
- * (all stored as bits in a long, i.e. the k-th bit is the coefficient of t^k)
+ * (all stored in binary form, i.e. the k-th bit is the coefficient of t^k;
+ * wide values can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
  * 
  * Command line arguments: < b0, b1, timeout, gap >
  * 		b0, b1: initial polynomial f = b0 + xb1
@@ -37,11 +39,11 @@ int main( int argc, char **argv )
 	unsigned int timeout = strtoul( argv[ 3 ], NULL, 0 );
 	unsigned int gap = strtoul( argv[ 4 ], NULL, 0 );
 	
-	uint64_t m0 = strtoul( getenv( "F2XT_M0" ), NULL, 0 );
-	uint64_t m1 = strtoul( getenv( "F2XT_M1" ), NULL, 0 );
-	uint64_t a0 = strtoul( getenv( "F2XT_A0" ), NULL, 0 );
-	uint64_t a1 = strtoul( getenv( "F2XT_A1" ), NULL, 0 );
-	uint64_t q = strtoul( getenv( "F2XT_Q" ), NULL, 0 );
+	f2poly_t m0 = f2poly_parse( getenv( "F2XT_M0" ) );
+	f2poly_t m1 = f2poly_parse( getenv( "F2XT_M1" ) );
+	f2poly_t a0 = f2poly_parse( getenv( "F2XT_A0" ) );
+	f2poly_t a1 = f2poly_parse( getenv( "F2XT_A1" ) );
+	f2poly_t q = f2poly_parse( getenv( "F2XT_Q" ) );
 	
 	f2xt_sequence_t f( m0, m1, a0, a1, q );
 	f.setpolys( 1, b0, 1, b1 );
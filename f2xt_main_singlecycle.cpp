@@ -13,7 +13,17 @@
  * 
  * F2XT_Q		quotient polynomial; ring is F_2[x,t] / (x^2 + tx + q(t))
  * 
- * (all stored as bits in a long, i.e. the k-th bit is the coefficient of t^k)
+ * (all stored in binary form, i.e. the k-th bit is the coefficient of t^k;
+ * wide values can be given as one long hex number, or as dotted words,
+ * least significant first, as printed by printhex)
+ * 
+ * Optionally, F2XT_JUMP sets k for the k-step jump table used by the cycle
+ * search (0 for single steps only, default 6; k is capped so that the
+ * table entries fit in a word, see f2xt_sequence.h)
+ * 
+ * F2XT_DETECTOR picks the cycle detection algorithm, brent (the default) or
+ * nivasch (see cycle_detector.h). nivasch takes single steps and ignores
+ * F2XT_JUMP, with a warning if it is set.
  * 
  * Command line arguments: < b0, b1, timeout >
  * 		b0, b1: initial polynomial f = b0 + xb1
@@ -54,15 +64,29 @@ int main( int argc, char **argv )
 		return 1;
 	}
 	
-	uint64_t m0 = strtoul( env_F2XT_M0, NULL, 0 );
-	uint64_t m1 = strtoul( env_F2XT_M1, NULL, 0 );
-	uint64_t a0 = strtoul( env_F2XT_A0, NULL, 0 );
-	uint64_t a1 = strtoul( env_F2XT_A1, NULL, 0 );
-	uint64_t q = strtoul( env_F2XT_Q, NULL, 0 );
+	f2poly_t m0 = f2poly_parse( env_F2XT_M0 );
+	f2poly_t m1 = f2poly_parse( env_F2XT_M1 );
+	f2poly_t a0 = f2poly_parse( env_F2XT_A0 );
+	f2poly_t a1 = f2poly_parse( env_F2XT_A1 );
+	f2poly_t q = f2poly_parse( env_F2XT_Q );
+	
+	char *env_F2XT_JUMP = getenv( "F2XT_JUMP" );
+	unsigned int k = env_F2XT_JUMP ? strtoul( env_F2XT_JUMP, NULL, 0 ) : F2XT_JUMP_DEFAULT;
+	
+	cycle_detector_t detector;
+	if( !cycle_detector_parse( getenv( "F2XT_DETECTOR" ), &detector ) )
+	{
+		printf( "Error: unknown cycle detector %s.\n", getenv( "F2XT_DETECTOR" ) );
+		return 1;
+	}
+	
+	const char *const brent_only[ ] = { "F2XT_JUMP", NULL };
+	cycle_detector_ignored( detector, brent_only );
 	
 	f2xt_sequence_t f( m0, m1, a0, a1, q );
 	f.setpolys( 1, b0, 1, b1 );
+	f.set_jump( detector == DETECT_BRENT ? k : 0 );
 	
-	f2xt_run_and_print( f, timeout );
+	f2xt_run_and_print( f, timeout, detector );
 	
 }
@@ -0,0 +1,345 @@
+#include "f2xt_pair.h"
+#include <cstdint>
+#include <vector>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+
+
+/**********************************************************************/
+/*************************** THE ODD STEP *****************************/
+/**********************************************************************/
+
+
+// One pass of the odd step over the interleaved words w of f0 and f1, read
+// from skip words and shift bits up (the pending divisions): for each k,
+// word k of each of the four products
+//     A = f0m0, B = f1m1, C = ( f0 + f1 )( m0 + m1 ), qB
+// (carrying the high halves into word k + 1), then word k of
+//     X0 = A + qB + a0,  X1 = C + A + B + a1
+// and word k - 1 of the new f0 = X0/t and f1 = X1/t + B, written over words
+// which have already been read. m holds m0, m1, m0 + m1 and q; l is the
+// number of words of X0 and X1, and w has to have (at least) 2( skip + l )
+// + 4 words, all 0 above f0 and f1. The bits dropped by the division are
+// left in low.
+template< class W >
+static inline __attribute__(( always_inline )) void f2xt_pair_step_body( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *m, const f2poly_t &a0, const f2poly_t &a1, uint64_t *low )
+{
+	const uint64_t *src = w + 2 * skip;
+	uint64_t ca = 0, cb = 0, cc = 0, cq = 0, hi;
+	uint64_t x0 = 0, x1 = 0, b = 0;		// word k - 1 of X0, X1 and B
+
+	// (the second shift is split in two so that shift = 0 works)
+	for( unsigned int k = 0; k <= l; k++ )
+	{
+		uint64_t u0 = ( src[ 2 * k ] >> shift ) | ( ( src[ 2 * k + 2 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+		uint64_t u1 = ( src[ 2 * k + 1 ] >> shift ) | ( ( src[ 2 * k + 3 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+
+		uint64_t pa = W::mul( u0, *m[ 0 ], &hi ) ^ ca;
+		ca = hi;
+		uint64_t pb = W::mul( u1, *m[ 1 ], &hi ) ^ cb;
+		cb = hi;
+		uint64_t pc = W::mul( u0 ^ u1, *m[ 2 ], &hi ) ^ cc;
+		cc = hi;
+		uint64_t pq = W::mul( pb, *m[ 3 ], &hi ) ^ cq;
+		cq = hi;
+
+		uint64_t y0 = pa ^ pq ^ a0.word( k );
+		uint64_t y1 = pc ^ pa ^ pb ^ a1.word( k );
+
+		if( k )
+		{
+			w[ 2 * k - 2 ] = ( x0 >> 1 ) | ( y0 << ( WORDLENGTH - 1 ) );
+			w[ 2 * k - 1 ] = ( ( x1 >> 1 ) | ( y1 << ( WORDLENGTH - 1 ) ) ) ^ b;
+		}
+		else
+			*low = ( y0 & 1 ) | ( y1 & 1 ) << 1;
+
+		x0 = y0;
+		x1 = y1;
+		b = pb;
+	}
+}
+
+
+static void f2xt_pair_step_loop( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *m, const f2poly_t &a0, const f2poly_t &a1, uint64_t *low )
+{
+	f2xt_pair_step_body< f2poly_mulword_loop_t >( w, skip, shift, l, m, a0, a1, low );
+}
+
+
+#if defined( __x86_64__ )
+
+// the word product by carry-less multiply, inlined into the pass (flatten)
+struct f2xt_mulword_pclmul_t
+{
+	__attribute__(( target( "pclmul" ) ))
+	static inline uint64_t mul( uint64_t a, const f2poly_mword_t &m, uint64_t *hi )
+	{
+		__m128i p = _mm_clmulepi64_si128( _mm_cvtsi64_si128( a ), _mm_cvtsi64_si128( m.m ), 0x00 );
+
+		*hi = _mm_cvtsi128_si64( _mm_unpackhi_epi64( p, p ) );
+		return _mm_cvtsi128_si64( p );
+	}
+};
+
+
+__attribute__(( target( "pclmul" ), flatten ))
+static void f2xt_pair_step_pclmul( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *m, const f2poly_t &a0, const f2poly_t &a1, uint64_t *low )
+{
+	f2xt_pair_step_body< f2xt_mulword_pclmul_t >( w, skip, shift, l, m, a0, a1, low );
+}
+
+#endif
+
+
+void f2xt_pair_t< f2poly_t >::mxplus1( const f2poly_multiplier_t< f2poly_t > &m0, const f2poly_multiplier_t< f2poly_t > &m1, const f2poly_multiplier_t< f2poly_t > &m01, const f2poly_multiplier_t< f2poly_t > &q, const f2poly_t &a0, const f2poly_t &a1, unsigned int d )
+{
+	// wide multipliers take the products one at a time
+	if( m0.poly( ).size( ) > 1 || m1.poly( ).size( ) > 1 || m01.poly( ).size( ) > 1 || q.poly( ).size( ) > 1 )
+	{
+		f2poly_t f0 = poly0( ), f1 = poly1( );
+		f2xt_mxplus1_split( f0, f1, m0, m1, m01, q, a0, a1 );
+
+		static thread_local std::vector<uint64_t> v0, v1;
+		f0.wordvector( v0 );
+		f1.wordvector( v1 );
+		set( v0, v1 );
+		return;
+	}
+
+	const f2poly_mword_t *m[ 4 ] = { &m0.mword( ), &m1.mword( ), &m01.mword( ), &q.mword( ) };
+
+	unsigned int l = d / WORDLENGTH + 1;
+	unsigned int skip = offset / WORDLENGTH;
+	if( words.size( ) < 2 * ( skip + l ) + 4 )
+		words.resize( 2 * ( skip + l ) + 4, 0 );
+
+	uint64_t low;
+#if defined( __x86_64__ )
+	if( f2poly_has_clmul( ) )
+		f2xt_pair_step_pclmul( &words[ 0 ], skip, offset % WORDLENGTH, l, m, a0, a1, &low );
+	else
+#endif
+		f2xt_pair_step_loop( &words[ 0 ], skip, offset % WORDLENGTH, l, m, a0, a1, &low );
+
+	words.resize( 2 * l );
+	offset = 0;
+	find_degrees( );
+
+	// the fingerprints go the same way, with the dropped bits taken off
+	// before the division
+	uint64_t fa = f2poly_gfmul( fprint0, m[ 0 ]->m );
+	uint64_t fb = f2poly_gfmul( fprint1, m[ 1 ]->m );
+	uint64_t fc = f2poly_gfmul( fprint0 ^ fprint1, m[ 2 ]->m );
+
+	fprint0 = f2poly_gfdivalpha( fa ^ f2poly_gfmul( fb, m[ 3 ]->m ) ^ a0.fingerprint( ) ^ ( low & 1 ) );
+	fprint1 = f2poly_gfdivalpha( fc ^ fa ^ fb ^ a1.fingerprint( ) ^ ( low >> 1 ) ) ^ fb;
+}
+
+
+
+/**********************************************************************/
+/****************************** THE JUMP ******************************/
+/**********************************************************************/
+
+
+// One pass of a jump (see f2xt_jump_table_t) over the interleaved words w
+// of f0 and f1, read from skip words and shift bits up (the pending
+// divisions and the k of the jump, so that what is read is h): for each k,
+// word k of the four products by the entries a of the matrix (carrying the
+// high halves into word k + 1), summed into word k of the new f0 and f1 and
+// written over words which have already been read. r0 and r1 go into word
+// 0. l is the number of words of the result, and w has to have (at least)
+// 2( skip + l ) + 4 words, all 0 above f0 and f1.
+template< class W >
+static inline __attribute__(( always_inline )) void f2xt_pair_jump_body( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *a, uint64_t r0, uint64_t r1 )
+{
+	const uint64_t *src = w + 2 * skip;
+	uint64_t c00 = 0, c01 = 0, c10 = 0, c11 = 0, hi;
+	
+	// (the second shift is split in two so that shift = 0 works)
+	for( unsigned int k = 0; k < l; k++ )
+	{
+		uint64_t u0 = ( src[ 2 * k ] >> shift ) | ( ( src[ 2 * k + 2 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+		uint64_t u1 = ( src[ 2 * k + 1 ] >> shift ) | ( ( src[ 2 * k + 3 ] << 1 ) << ( WORDLENGTH - 1 - shift ) );
+		
+		uint64_t p00 = W::mul( u0, *a[ 0 ], &hi ) ^ c00;
+		c00 = hi;
+		uint64_t p01 = W::mul( u1, *a[ 1 ], &hi ) ^ c01;
+		c01 = hi;
+		uint64_t p10 = W::mul( u0, *a[ 2 ], &hi ) ^ c10;
+		c10 = hi;
+		uint64_t p11 = W::mul( u1, *a[ 3 ], &hi ) ^ c11;
+		c11 = hi;
+		
+		w[ 2 * k ] = p00 ^ p01 ^ r0;
+		w[ 2 * k + 1 ] = p10 ^ p11 ^ r1;
+		r0 = r1 = 0;
+	}
+}
+
+
+static void f2xt_pair_jump_loop( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *a, uint64_t r0, uint64_t r1 )
+{
+	f2xt_pair_jump_body< f2poly_mulword_loop_t >( w, skip, shift, l, a, r0, r1 );
+}
+
+
+#if defined( __x86_64__ )
+
+__attribute__(( target( "pclmul" ), flatten ))
+static void f2xt_pair_jump_pclmul( uint64_t *w, unsigned int skip, unsigned int shift, unsigned int l, const f2poly_mword_t * const *a, uint64_t r0, uint64_t r1 )
+{
+	f2xt_pair_jump_body< f2xt_mulword_pclmul_t >( w, skip, shift, l, a, r0, r1 );
+}
+
+#endif
+
+
+// the entries of the matrix are single words (the jump table sees to
+// that), so the result has at most a word more than h
+void f2xt_pair_t< f2poly_t >::jump( const f2poly_multiplier_t< f2poly_t > *a, uint64_t r0, uint64_t r1, unsigned int k )
+{
+	const f2poly_mword_t *m[ 4 ] = { &a[ 0 ].mword( ), &a[ 1 ].mword( ), &a[ 2 ].mword( ), &a[ 3 ].mword( ) };
+	
+	// h = f/t^k, and its fingerprints, which are needed before the words
+	// are overwritten
+	uint64_t low = ( uint64_t( 1 ) << k ) - 1;
+	uint64_t h0 = fprint0 ^ ( word( 0, 0 ) & low );
+	uint64_t h1 = fprint1 ^ ( word( 1, 0 ) & low );
+	for( unsigned int j = 0; j < k; j++ )
+	{
+		h0 = f2poly_gfdivalpha( h0 );
+		h1 = f2poly_gfdivalpha( h1 );
+	}
+	
+	unsigned int d = deg0 > deg1 ? deg0 : deg1;
+	unsigned int l = ( d > k ? d - k : 0 ) / WORDLENGTH + 2;
+	unsigned int skip = ( offset + k ) / WORDLENGTH;
+	if( words.size( ) < 2 * ( skip + l ) + 4 )
+		words.resize( 2 * ( skip + l ) + 4, 0 );
+	
+#if defined( __x86_64__ )
+	if( f2poly_has_clmul( ) )
+		f2xt_pair_jump_pclmul( &words[ 0 ], skip, ( offset + k ) % WORDLENGTH, l, m, r0, r1 );
+	else
+#endif
+		f2xt_pair_jump_loop( &words[ 0 ], skip, ( offset + k ) % WORDLENGTH, l, m, r0, r1 );
+	
+	words.resize( 2 * l );
+	offset = 0;
+	find_degrees( );
+	
+	fprint0 = f2poly_gfmul( h0, m[ 0 ]->m ) ^ f2poly_gfmul( h1, m[ 1 ]->m ) ^ r0;
+	fprint1 = f2poly_gfmul( h0, m[ 2 ]->m ) ^ f2poly_gfmul( h1, m[ 3 ]->m ) ^ r1;
+}
+
+
+
+/**********************************************************************/
+/*************************** OTHER METHODS ****************************/
+/**********************************************************************/
+
+
+void f2xt_pair_t< f2poly_t >::set( const std::vector<uint64_t> &v0, const std::vector<uint64_t> &v1 )
+{
+	unsigned int l = v0.size( ) > v1.size( ) ? v0.size( ) : v1.size( );
+	words.assign( 2 * ( l ? l : 1 ), 0 );
+
+	for( unsigned int k = 0; k < v0.size( ); k++ )
+		words[ 2 * k ] = v0[ k ];
+	for( unsigned int k = 0; k < v1.size( ); k++ )
+		words[ 2 * k + 1 ] = v1[ k ];
+
+	offset = 0;
+	fprint0 = f2poly_fingerprint( v0.data( ), v0.size( ) );
+	fprint1 = f2poly_fingerprint( v1.data( ), v1.size( ) );
+	find_degrees( );
+}
+
+
+void f2xt_pair_t< f2poly_t >::set( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 )
+{
+	static thread_local std::vector<uint64_t> v0, v1;
+	f2poly_t( l0, b0 ).wordvector( v0 );
+	f2poly_t( l1, b1 ).wordvector( v1 );
+	set( v0, v1 );
+}
+
+
+// (the words have to be normalized)
+void f2xt_pair_t< f2poly_t >::find_degrees( )
+{
+	unsigned int d[ 2 ] = { 0, 0 };
+
+	for( unsigned int c = 0; c < 2; c++ )
+		for( unsigned int k = words.size( ) / 2; k-- > 0; )
+			if( words[ 2 * k + c ] )
+			{
+				d[ c ] = WORDLENGTH * k + topbit( words[ 2 * k + c ] );
+				break;
+			}
+
+	deg0 = d[ 0 ];
+	deg1 = d[ 1 ];
+}
+
+
+f2poly_t f2xt_pair_t< f2poly_t >::poly0( ) const
+{
+	std::vector<uint64_t> a0, a1;
+	wordvectors( a0, a1 );
+	return f2poly_t( a0 );
+}
+
+
+f2poly_t f2xt_pair_t< f2poly_t >::poly1( ) const
+{
+	std::vector<uint64_t> a0, a1;
+	wordvectors( a0, a1 );
+	return f2poly_t( a1 );
+}
+
+
+// both at once: the bits dropped come off the fingerprints first
+void f2xt_pair_t< f2poly_t >::divide( )
+{
+	int p = parity( );
+	fprint0 = f2poly_gfdivalpha( fprint0 ^ ( p & 1 ) );
+	fprint1 = f2poly_gfdivalpha( fprint1 ^ ( p >> 1 ) );
+
+	offset++;
+	deg0 = deg0 ? deg0 - 1 : 0;
+	deg1 = deg1 ? deg1 - 1 : 0;
+}
+
+
+void f2xt_pair_t< f2poly_t >::wordvectors( std::vector<uint64_t> &a0, std::vector<uint64_t> &a1 ) const
+{
+	a0.resize( deg0 / WORDLENGTH + 1 );
+	a1.resize( deg1 / WORDLENGTH + 1 );
+
+	for( unsigned int k = 0; k < a0.size( ) || k < a1.size( ); k++ )
+	{
+		if( k < a0.size( ) )
+			a0[ k ] = word( 0, k );
+		if( k < a1.size( ) )
+			a1[ k ] = word( 1, k );
+	}
+}
+
+
+bool f2xt_pair_t< f2poly_t >::operator==( const f2xt_pair_t &other ) const
+{
+	if( fprint0 != other.fprint0 || fprint1 != other.fprint1 || deg0 != other.deg0 || deg1 != other.deg1 )
+		return false;
+
+	for( unsigned int k = 0; k < size( ); k++ )
+		if( word( 0, k ) != other.word( 0, k ) || word( 1, k ) != other.word( 1, k ) )
+			return false;
+
+	return true;
+}
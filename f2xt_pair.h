@@ -0,0 +1,222 @@
+/* f2xt_pair_t
+ *
+ * The two coordinates f0, f1 of an element f0 + x f1 of F_2[x,t]/(x^2 +
+ * tx + q(t)), for f2xt_sequence_base_t, along with what the sequence does
+ * to both of them at once: the mx+1 step, division by t, comparison.
+ *
+ * For the fixed width types it is just the two polynomials, which are
+ * stored inline next to each other anyway. For f2poly_t it is specialized:
+ * the words of f0 and f1 are interleaved in one array (word k of f0, then
+ * word k of f1, then word k + 1 of each), both are divided by t lazily with
+ * one shared offset (they are always divided together), and each operation
+ * is a single pass over the array. The odd step, with one word
+ * multipliers, is one pass for all the products, the sums and the division,
+ * and so is a k-step jump (see f2xt_pair.cpp).
+ *
+ */
+
+
+#ifndef F2XT_PAIR_H
+#define F2XT_PAIR_H
+
+#include "f2poly.h"
+#include "f2poly_fixed.h"
+#include "f2poly_multiplier.h"
+#include <cstdint>
+#include <vector>
+
+
+// a fixed dense element of GF(2^64), so that the fingerprints of f0 and
+// f1 don't just overlap
+#define HASH_BETA 0x9e3779b97f4a7c15
+
+
+template< class P >
+class f2xt_pair_t
+{
+	private:
+		P f0;
+		P f1;
+
+	public:
+		f2xt_pair_t( ) { }
+
+		// the same pair stored with another polynomial type (which has to
+		// be big enough)
+		template< class Q >
+		explicit f2xt_pair_t( const f2xt_pair_t< Q > &other )
+		{
+			static thread_local std::vector<uint64_t> a0, a1;
+			other.wordvectors( a0, a1 );
+			set( a0, a1 );
+		}
+
+		void set( const std::vector<uint64_t> &v0, const std::vector<uint64_t> &v1 ) { f0 = P( v0 ); f1 = P( v1 ); }
+		void set( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 ) { f0 = P( l0, b0 ); f1 = P( l1, b1 ); }
+
+		unsigned int degree0( ) const { return f0.degree; }
+		unsigned int degree1( ) const { return f1.degree; }
+		P poly0( ) const { return f0; }
+		P poly1( ) const { return f1; }
+
+		int parity( ) { return f0.parity( ) + ( f1.parity( ) << 1 ); }
+		uint64_t bottom0( ) { return f0.bottomword( ); }
+		uint64_t bottom1( ) { return f1.bottomword( ); }
+		bool is_zero( ) { return f0.is_zero( ) && f1.is_zero( ); }
+		void divide( ) { f0.divide( ); f1.divide( ); }
+
+		// fingerprint of the pair, f0(alpha) + beta f1(alpha) (see f2poly.h)
+		uint64_t hash( ) const { return f0.fingerprint( ) ^ f2poly_gfmul( f1.fingerprint( ), HASH_BETA ); }
+		void wordvectors( std::vector<uint64_t> &a0, std::vector<uint64_t> &a1 ) const { f0.wordvector( a0 ); f1.wordvector( a1 ); }
+
+		bool operator==( const f2xt_pair_t &other ) const { return f0 == other.f0 && f1 == other.f1; }
+
+		// f = ( f*m + a )/t, for m = m0 + x m1, a = a0 + x a1, with m01 =
+		// m0 + m1 and d at least the degree of f*m + a
+		void mxplus1( const f2poly_multiplier_t< P > &m0, const f2poly_multiplier_t< P > &m1, const f2poly_multiplier_t< P > &m01, const f2poly_multiplier_t< P > &q, const f2poly_t &a0, const f2poly_t &a1, unsigned int d );
+		
+		// f = A*( f/t^k ) + r, for the 2x2 matrix A = [ a[ 0 ] a[ 1 ]; a[ 2 ]
+		// a[ 3 ] ] (a k-step jump, see f2xt_jump_table_t)
+		void jump( const f2poly_multiplier_t< P > *a, uint64_t r0, uint64_t r1, unsigned int k );
+};
+
+
+
+template< >
+class f2xt_pair_t< f2poly_t >
+{
+	private:
+		f2poly_words_t words;	// word k of f0 at 2k, of f1 at 2k + 1
+		unsigned int offset;	// divisions by t not applied to the words yet
+		uint64_t fprint0, fprint1;
+		unsigned int deg0, deg1;
+
+		// word k of f0 (c = 0) or f1 (c = 1), taking the offset into account
+		uint64_t word( unsigned int c, unsigned int k ) const
+		{
+			unsigned int j = 2 * ( k + offset / WORDLENGTH ) + c;
+			unsigned int shift = offset % WORDLENGTH;
+
+			uint64_t w = j < words.size( ) ? words[ j ] >> shift : 0;
+			if( shift && j + 2 < words.size( ) )
+				w |= words[ j + 2 ] << ( WORDLENGTH - shift );
+			return w;
+		}
+
+		// number of words of each, up to the higher degree
+		unsigned int size( ) const { return ( deg0 > deg1 ? deg0 : deg1 ) / WORDLENGTH + 1; }
+
+		void find_degrees( );
+
+	public:
+		f2xt_pair_t( ) : words( 2, 0 ), offset( 0 ), fprint0( 0 ), fprint1( 0 ), deg0( 0 ), deg1( 0 ) { }
+
+		template< class Q >
+		explicit f2xt_pair_t( const f2xt_pair_t< Q > &other ) : offset( 0 )
+		{
+			static thread_local std::vector<uint64_t> a0, a1;
+			other.wordvectors( a0, a1 );
+			set( a0, a1 );
+		}
+
+		void set( const std::vector<uint64_t> &v0, const std::vector<uint64_t> &v1 );
+		void set( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 );
+
+		unsigned int degree0( ) const { return deg0; }
+		unsigned int degree1( ) const { return deg1; }
+		f2poly_t poly0( ) const;
+		f2poly_t poly1( ) const;
+
+		int parity( ) const { return ( word( 0, 0 ) & 1 ) + ( ( word( 1, 0 ) & 1 ) << 1 ); }
+		uint64_t bottom0( ) const { return word( 0, 0 ); }
+		uint64_t bottom1( ) const { return word( 1, 0 ); }
+		bool is_zero( ) const { return !deg0 && !deg1 && !word( 0, 0 ) && !word( 1, 0 ); }
+		void divide( );
+
+		uint64_t hash( ) const { return fprint0 ^ f2poly_gfmul( fprint1, HASH_BETA ); }
+		void wordvectors( std::vector<uint64_t> &a0, std::vector<uint64_t> &a1 ) const;
+
+		bool operator==( const f2xt_pair_t &other ) const;
+
+		void mxplus1( const f2poly_multiplier_t< f2poly_t > &m0, const f2poly_multiplier_t< f2poly_t > &m1, const f2poly_multiplier_t< f2poly_t > &m01, const f2poly_multiplier_t< f2poly_t > &q, const f2poly_t &a0, const f2poly_t &a1, unsigned int d );
+		void jump( const f2poly_multiplier_t< f2poly_t > *a, uint64_t r0, uint64_t r1, unsigned int k );
+};
+
+
+
+// With f = f0 + xf1 and x^2 = tx + q,
+//     f*m = f0m0 + q f1m1 + x( f0m1 + f1m0 + t f1m1 )
+// and the middle term is ( f0 + f1 )( m0 + m1 ) + f0m0 + f1m1, so three
+// products by m0, m1 and m0 + m1 are enough (Karatsuba), plus the one by q.
+// f0 and f1 are multiplied in place, and since t f1m1 / t = f1m1 the shift
+// by t is taken out again by the division instead of being done. The
+// scratch polynomials keep their word arrays from one step to the next.
+template< class P >
+inline void f2xt_mxplus1_split( P &f0, P &f1, const f2poly_multiplier_t< P > &m0, const f2poly_multiplier_t< P > &m1, const f2poly_multiplier_t< P > &m01, const f2poly_multiplier_t< P > &q, const f2poly_t &a0, const f2poly_t &a1 )
+{
+	static thread_local P middle, f1m1q;
+
+	middle = f0;
+	middle += f1;
+	m01.multiply( middle );		// ( f0 + f1 )( m0 + m1 )
+	m0.multiply( f0 );			// f0m0
+	m1.multiply( f1 );			// f1m1
+
+	f1m1q = f1;
+	q.multiply( f1m1q );
+
+	middle += f0;
+	middle += f1;
+	middle += a1;
+	middle.divide( );
+
+	f0 += f1m1q;
+	f0 += a0;
+	f0.divide( );
+
+	f1 += middle;
+}
+
+
+// the jump: four products, with the two scratch copies of f0/t^k and
+// f1/t^k kept from one jump to the next as above
+template< class P >
+inline void f2xt_jump_split( P &f0, P &f1, const f2poly_multiplier_t< P > *a, uint64_t r0, uint64_t r1, unsigned int k )
+{
+	static thread_local P g0, g1;
+	
+	f0.divide( k );
+	f1.divide( k );
+	g0 = f0;
+	g1 = f1;
+	
+	a[ 0 ].multiply( f0 );
+	a[ 1 ].multiply( g1 );
+	a[ 2 ].multiply( g0 );
+	a[ 3 ].multiply( f1 );
+	
+	f0 += g1;
+	f0 += r0;
+	f1 += g0;
+	f1 += r1;
+}
+
+
+template< class P >
+void f2xt_pair_t<P>::mxplus1( const f2poly_multiplier_t< P > &m0, const f2poly_multiplier_t< P > &m1, const f2poly_multiplier_t< P > &m01, const f2poly_multiplier_t< P > &q, const f2poly_t &a0, const f2poly_t &a1, unsigned int d )
+{
+	(void) d;
+	f2xt_mxplus1_split( f0, f1, m0, m1, m01, q, a0, a1 );
+}
+
+
+template< class P >
+void f2xt_pair_t<P>::jump( const f2poly_multiplier_t< P > *a, uint64_t r0, uint64_t r1, unsigned int k )
+{
+	f2xt_jump_split( f0, f1, a, r0, r1, k );
+}
+
+
+
+
+#endif
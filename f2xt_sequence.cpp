@@ -2,6 +2,121 @@
 #include "f2xt_sequence.h"
 #include <cstdint>
 #include <cstdio>
+#include <mutex>
+
+
+
+
+/**********************************************************************/
+/**************************** JUMP TABLES *****************************/
+/**********************************************************************/
+
+
+// the terms from x have degree < k*growth, and the entries of M^k at most
+// k*growth, where growth is as in set_growth( ), so that has to be < 64
+template< class P >
+unsigned int f2xt_jump_table_t<P>::cap( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k )
+{
+	if( m0.size( ) > 1 || m1.size( ) > 1 || a0.size( ) > 1 || a1.size( ) > 1 || q.size( ) > 1 )
+		return 0;
+	
+	unsigned int growth = m1.degree + ( q.degree > 1 ? q.degree : 1 );
+	if( m0.degree > growth )
+		growth = m0.degree;
+	
+	if( k > F2XT_JUMP_MAX )
+		k = F2XT_JUMP_MAX;
+	if( k * growth >= WORDLENGTH )
+		k = ( WORDLENGTH - 1 ) / growth;
+	
+	return k;
+}
+
+
+// the tables are never freed, a program only uses one or two of them
+template< class P >
+const f2xt_jump_table_t<P> *f2xt_jump_table_t<P>::get( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k )
+{
+	static std::mutex lock;
+	static std::vector< const f2xt_jump_table_t* > tables;
+	
+	k = cap( m0, m1, a0, a1, q, k );
+	if( k < 2 )
+		return NULL;
+	
+	std::lock_guard< std::mutex > guard( lock );
+	
+	for( unsigned int i = 0; i < tables.size( ); i++ )
+	{
+		const f2xt_jump_table_t *t = tables[ i ];
+		if( t->k == k && t->m0 == m0 && t->m1 == m1 && t->a0 == a0 && t->a1 == a1 && t->q == q )
+			return t;
+	}
+	
+	tables.push_back( new f2xt_jump_table_t( m0, m1, a0, a1, q, k ) );
+	return tables.back( );
+}
+
+
+// each entry is found by taking the k steps from x itself: f = x goes to
+// r, since h = 0. The terms on the way have degree < k*growth, so they fit
+// in two words.
+template< class P >
+f2xt_jump_table_t<P>::f2xt_jump_table_t( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int steps )
+	: m0( m0 ), m1( m1 ), a0( a0 ), a1( a1 ), q( q ),
+	entries( uint64_t( 1 ) << 2 * steps ), k( steps ), mask( ( uint64_t( 1 ) << steps ) - 1 )
+{
+	f2poly_t m[ 4 ] = { m0, m1 * q, m1, m0 + m1 * f2poly_t( 1, 2 ) };
+	f2poly_t power[ 4 ] = { f2poly_t( 1, 1 ), f2poly_t( ), f2poly_t( ), f2poly_t( 1, 1 ) };
+	
+	for( unsigned int a = 0; a <= k; a++ )
+	{
+		for( unsigned int c = 0; c < 4; c++ )
+			powers.push_back( f2poly_multiplier_t< P >( power[ c ] ) );
+		
+		f2poly_t next[ 4 ];
+		for( unsigned int c = 0; c < 4; c++ )
+			next[ c ] = power[ c & 2 ] * m[ c & 1 ] + power[ ( c & 2 ) + 1 ] * m[ ( c & 1 ) + 2 ];
+		for( unsigned int c = 0; c < 4; c++ )
+			power[ c ] = next[ c ];
+	}
+	
+	// the degree bound (see above)
+	unsigned int e = 0;
+	for( unsigned int c = 0; c < 4; c++ )
+		if( m[ c ].degree > e )
+			e = m[ c ].degree;
+	
+	f2poly_t det = m[ 0 ] * m[ 3 ] + m[ 1 ] * m[ 2 ];
+	unsigned int adddeg = a0.degree > a1.degree ? a0.degree : a1.degree;
+	
+	drop = det.is_zero( ) ? 0 : e + 1 > det.degree + 1 ? e + 1 - det.degree : 1;
+	floor = (int) adddeg + (int) e - (int) det.degree;
+	
+	f2xt_sequence_base_t< f2poly_fixed<2> > f( m0, m1, a0, a1, q );
+	std::vector<uint64_t> x0( 1 ), x1( 1 ), r0, r1;
+	
+	for( uint64_t x = 0; x < entries.size( ); x++ )
+	{
+		f2xt_jump_entry_t &entry = entries[ x ];
+		
+		x0[ 0 ] = x & mask;
+		x1[ 0 ] = x >> k;
+		f.setpolys( x0, x1 );
+		
+		entry.odd = 0;
+		for( unsigned int j = 0; j < k; j++ )
+		{
+			if( f.parity( ) == 3 )
+				entry.odd++;
+			f.step( );
+		}
+		
+		f.wordvectors( r0, r1 );
+		entry.r0 = r0[ 0 ];
+		entry.r1 = r1[ 0 ];
+	}
+}
 
 
 
@@ -10,142 +125,179 @@
 /**********************************************************************/
 
 
-void f2xt_sequence_t::setpolys( std::vector<uint64_t> v0, std::vector<uint64_t> v1 )
+template< class P >
+void f2xt_sequence_base_t<P>::setpolys( const std::vector<uint64_t> &v0, const std::vector<uint64_t> &v1 )
 {
-	f0 = f2poly_t( v0 );
-	f1 = f2poly_t( v1 );
+	f.set( v0, v1 );
 	stepcount = 0;
 }
 
 
-void f2xt_sequence_t::setpolys( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 )
+template< class P >
+void f2xt_sequence_base_t<P>::setpolys( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 )
 {
-	f0 = f2poly_t( l0, b0 );
-	f1 = f2poly_t( l1, b1 );
+	f.set( l0, b0, l1, b1 );
 	stepcount = 0;
 }
 
 
 
+// f0 gets f1*m1*q and f1 gets f1*m1*t, so the degree goes up by at most
+// max( deg m0, deg m1 + max( deg q, 1 ) ) in one step
+template< class P >
+void f2xt_sequence_base_t<P>::set_growth( )
+{
+	unsigned int dq = qpoly.degree( );
+	
+	growth = multiplier1.degree( ) + ( dq > 1 ? dq : 1 );
+	if( multiplier0.degree( ) > growth )
+		growth = multiplier0.degree( );
+	
+	adddeg = add0.degree > add1.degree ? add0.degree : add1.degree;
+}
+
+
+
 /**********************************************************************/
 /*************************** OTHER METHODS ****************************/
 /**********************************************************************/
 
 
-bool f2xt_sequence_t::is_zero( )
+template< class P >
+bool f2xt_sequence_base_t<P>::is_zero( )
 {
-	return f0.is_zero( ) && f1.is_zero( );
+	return f.is_zero( );
 }
 
 
-void f2xt_sequence_t::divide( )
+template< class P >
+void f2xt_sequence_base_t<P>::divide( )
 {
-	f0.divide( );
-	f1.divide( );
+	f.divide( );
 }
 
 
-void f2xt_sequence_t::step( )
+// the odd step is done by the pair (see f2xt_pair.h), which is told how
+// big the result can get
+template< class P >
+void f2xt_sequence_base_t<P>::step( )
 {
 	if( !is_zero( ) )
 	{
-
-		if( f0.parity( ) && f1.parity( ) ) // multiply
-		{
-			
-			f2poly_t f0m0 = f0 * multiplier0;
-			f2poly_t f0m1 = f0 * multiplier1;
-			f2poly_t f1m0 = f1 * multiplier0;
-			f2poly_t f1m1 = f1 * multiplier1;
-			
-			f2poly_t f1m1q = f1m1 * qpoly;
-			
-			f2poly_t f1m1t = f1m1 * 2;
-			
-			f0 = f0m0;
-			f0 += f1m1q;
-			f0 += add0;
-			
-			f1 = f0m1;
-			f1 += f1m0;
-			f1 += f1m1t;
-			f1 += add1;
-			
-		}
-		
-		f0.divide( );
-		f1.divide( );
-		
+		if( parity( ) == 3 ) // multiply
+			f.mxplus1( multiplier0, multiplier1, multiplier01, qpoly, add0, add1, step_degree( ) );
+		else
+			f.divide( );
 	}
 	
 	stepcount++;
 }
 
 
-unsigned int f2xt_sequence_t::degree( )
+// f = t^k*h + x goes to M^a*h + r
+template< class P >
+void f2xt_sequence_base_t<P>::step_k( )
 {
-	unsigned int d = f0.degree;
-	if( f1.degree > d )
-		d = f1.degree;
+	const f2xt_jump_entry_t &e = jump_entry( );
+	
+	f.jump( jump->power( e.odd ), e.r0, e.r1, jump->k );
+	stepcount += jump->k;
+}
+
+
+// Each step from a term of degree d > floor gives one of degree >= d -
+// drop, so going by the lowest the terms can get, those before the k-th
+// have degree >= d - ( k - 1 )*drop as long as that is > floor (and > 0).
+template< class P >
+unsigned int f2xt_sequence_base_t<P>::jump_low( ) const
+{
+	unsigned int d = degree( ), fall = ( jump->k - 1 ) * jump->drop;
+	
+	if( !jump->drop || d <= fall || (int) ( d - fall ) <= jump->floor )
+		return 0;
+	
+	return d - fall;
+}
+
+
+template< class P >
+unsigned int f2xt_sequence_base_t<P>::degree( ) const
+{
+	unsigned int d = f.degree0( );
+	if( f.degree1( ) > d )
+		d = f.degree1( );
 	
 	return d;
 }
 
 
-void f2xt_sequence_t::print( )
+template< class P >
+void f2xt_sequence_base_t<P>::print_kernels( ) const
+{
+	printf( "m0 %s, m1 %s, m0 + m1 %s, q %s", multiplier0.kernel_name( ),
+		multiplier1.kernel_name( ), multiplier01.kernel_name( ), qpoly.kernel_name( ) );
+}
+
+
+template< class P >
+void f2xt_sequence_base_t<P>::print( ) const
 {
 	printf( "f0 = " );
-	f0.print( );
+	f.poly0( ).print( );
 	printf( "\nf1 = " );
-	f1.print( );
+	f.poly1( ).print( );
 	printf( "\n" );
 	
 }
 
 
-void f2xt_sequence_t::print_short( )
+template< class P >
+void f2xt_sequence_base_t<P>::print_short( ) const
 {
-	f0.printdec( );
+	f.poly0( ).printdec( );
 	printf( " | " );
-	f1.printdec( );
+	f.poly1( ).printdec( );
 }
 
 
-void f2xt_sequence_t::print_sequence( unsigned int timeout )
+template< class P >
+void f2xt_sequence_base_t<P>::print_sequence( unsigned int timeout )
 {
 	printf( "i = %-6u: f0 = ", 0 );
-	f0.print( );
+	f.poly0( ).print( );
 	printf( "\n    %-6s  f1 = ", "" );
-	f1.print( );
+	f.poly1( ).print( );
 	printf( "\n\n" );
 	
 	for( unsigned int i = 1; i <= timeout && !is_zero( ); i++ )
 	{
 		step( );
 		printf( "i = %-6u: f0 = ", i );
-		f0.print( );
+		f.poly0( ).print( );
 		printf( "\n    %-6s  f1 = ", "" );
-		f1.print( );
+		f.poly1( ).print( );
 		printf( "\n\n" );
 	}
 	
 }
 
 
-void f2xt_sequence_t::print_sequence_degrees( unsigned int timeout, unsigned int gap )
+template< class P >
+void f2xt_sequence_base_t<P>::print_sequence_degrees( unsigned int timeout, unsigned int gap )
 {
 	printf( " %10s, %10s, %10s\n", "i", "deg f0", "deg f1" );
-	printf( "%10i, %10i, %10i\n", 0, f0.degree, f1.degree );
+	printf( "%10i, %10i, %10i\n", 0, f.degree0( ), f.degree1( ) );
 	
 	for( unsigned int i = 1; i <= timeout && !is_zero( ); i++ )
 	{
 		step( );
-		if( i % gap == 0 ) printf( "%10i, %10i, %10i\n", i, f0.degree, f1.degree );
+		if( i % gap == 0 ) printf( "%10i, %10i, %10i\n", i, f.degree0( ), f.degree1( ) );
 	}
 	
 }
 
-void f2xt_sequence_t::print_parity_sequence( unsigned int timeout )
+template< class P >
+void f2xt_sequence_base_t<P>::print_parity_sequence( unsigned int timeout )
 {
 	printf( "%i", parity( ) );
 	
@@ -158,15 +310,29 @@ void f2xt_sequence_t::print_parity_sequence( unsigned int timeout )
 }
 
 
-bool f2xt_sequence_t::operator==( const f2xt_sequence_t &other ) const
+template< class P >
+bool f2xt_sequence_base_t<P>::operator==( const f2xt_sequence_base_t &other ) const
 {
-	return ( f0 == other.f0 && f1 == other.f1 );
+	return f == other.f;
 }
 
 
 
-bool f2xt_sequence_t::operator!=( const f2xt_sequence_t &other ) const
+template< class P >
+bool f2xt_sequence_base_t<P>::operator!=( const f2xt_sequence_base_t &other ) const
 {
 	return !( *this == other );
 }
 
+
+
+// the polynomial types the sequence is used with
+template class f2xt_sequence_base_t< f2poly_t >;
+template class f2xt_sequence_base_t< f2poly_fixed<1> >;
+template class f2xt_sequence_base_t< f2poly_fixed<2> >;
+template class f2xt_sequence_base_t< f2poly_fixed<4> >;
+
+template class f2xt_jump_table_t< f2poly_t >;
+template class f2xt_jump_table_t< f2poly_fixed<1> >;
+template class f2xt_jump_table_t< f2poly_fixed<2> >;
+template class f2xt_jump_table_t< f2poly_fixed<4> >;
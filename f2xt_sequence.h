@@ -8,6 +8,10 @@
  * We store the current element f in F_2[x,t]/(), as well as the number of
  * steps so far and the multiplier polynomial m
  * 
+ * Like f2t_sequence_base_t, the class is a template over the polynomial
+ * type used for f0 and f1; f2xt_sequence_t uses the dynamic f2poly_t, with
+ * the words of f0 and f1 interleaved in one array (see f2xt_pair.h).
+ * 
  */
 
 
@@ -15,62 +19,218 @@
 #define F2XT_SEQUENCE_H
 
 #include "f2poly.h"
+#include "f2poly_fixed.h"
+#include "f2poly_multiplier.h"
+#include "f2xt_pair.h"
 #include <cstdint>
 #include <vector>
 
 
-class f2xt_sequence_t
+// largest k for a jump table (it has 4^k entries of 24 bytes)
+#define F2XT_JUMP_MAX 10
+
+// k used by the cycle finding drivers unless F2XT_JUMP says otherwise
+#define F2XT_JUMP_DEFAULT 6
+
+
+
+/* k-step jumps
+ *
+ * The step takes odd f (f0 and f1 both odd) to ( M*f + a )/t, where
+ *     M = [ m0   m1 q       ]
+ *         [ m1   m0 + t m1  ]
+ * is multiplication by m in the basis 1, x, and the other f to f/t. As in
+ * F_2[t] (see f2t_jump_table_t), writing f = t^k*h + x with x0 and x1 of
+ * degree < k, k steps take f to
+ *     M^a*h + r
+ * where a, the number of odd steps, and r = T^k( x ) depend only on the k
+ * lowest coefficients of f0 and f1. The table holds a and r for each of
+ * the 4^k x, and the entries of M^0, ..., M^k, so k steps cost four
+ * products instead of three for every odd one.
+ *
+ * Unlike in F_2[t] the top of M*f can cancel, so the degrees of the terms
+ * skipped aren't known from the parities, only bounded below (see
+ * jump_low( )): with adj( M )*M = det( M ), the degree of M*f is at least
+ * deg f + deg det( M ) - e, e being the highest degree in M.
+ *
+ * k is capped so that r and the entries of M^k fit in a word; there is no
+ * table unless m0, m1, a0, a1 and q all fit in a word.
+ */
+struct f2xt_jump_entry_t
+{
+	uint64_t r0, r1;
+	unsigned int odd;		// a
+};
+
+
+template< class P >
+class f2xt_jump_table_t
 {
 	private:
-		f2poly_t f0;
-		f2poly_t f1;
+		f2poly_t m0, m1, a0, a1, q;
+		std::vector< f2poly_multiplier_t< P > > powers;	// M^0 to M^k, 4 entries each
+		std::vector< f2xt_jump_entry_t > entries;
+		
+		f2xt_jump_table_t( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int steps );
+		
+	public:
+		const unsigned int k;
+		const uint64_t mask;	// the bits of f0 and f1 which pick the entry
+		
+		// One step lowers the degree by at most drop, as long as the degree
+		// is > floor; drop is 0 if det( M ) = 0, when there is no such bound
+		unsigned int drop;
+		int floor;
 		
-		uint64_t multiplier0;
-		uint64_t multiplier1;	// multiplier is m = m0(t) + xm1(t)
+		// the largest k <= requested one which works for the map (0 if none
+		// does)
+		static unsigned int cap( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k );
+		
+		// the table for the map and k (as capped), built on first use and
+		// shared by everything asking for the same one; NULL if k < 2
+		static const f2xt_jump_table_t *get( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k );
+		
+		const f2xt_jump_entry_t& lookup( uint64_t b0, uint64_t b1 ) const { return entries[ ( b0 & mask ) | ( b1 & mask ) << k ]; }
+		
+		// M^a, as its entries [ 0 1; 2 3 ]
+		const f2poly_multiplier_t< P > *power( unsigned int a ) const { return &powers[ 4 * a ]; }
+};
+
+
+
+template< class P >
+class f2xt_sequence_base_t
+{
+	template< class Q > friend class f2xt_sequence_base_t;
+	
+	private:
+		f2xt_pair_t< P > f;		// f0 and f1
 		
-		uint64_t add0;
-		uint64_t add1;			// perturbation is a = a0 + xa1
+		// each with the product kernel picked for its shape
+		f2poly_multiplier_t< P > multiplier0;
+		f2poly_multiplier_t< P > multiplier1;	// multiplier is m = m0(t) + xm1(t)
+		f2poly_multiplier_t< P > multiplier01;	// m0 + m1, for the middle product
 		
-		uint64_t qpoly;			// quotient polynomial q(t)
+		f2poly_t add0;
+		f2poly_t add1;			// perturbation is a = a0 + xa1
+		
+		f2poly_multiplier_t< P > qpoly;		// quotient polynomial q(t)
+		
+		unsigned int growth;	// the most one step can raise the degree
+		unsigned int adddeg;	// max( deg a0, deg a1 )
 		
 		unsigned int stepcount;
 		
+		const f2xt_jump_table_t< P > *jump;	// for step_k( ), or NULL
+		
+		void set_growth( );
+		
 	public:
-		f2xt_sequence_t( )
-			: multiplier0( 0 ), multiplier1( 0 ), add0( 0 ), add1( 0 ), qpoly( 2 ) { };
-		f2xt_sequence_t( uint64_t m0, uint64_t m1, uint64_t a0, uint64_t a1, uint64_t q )
-			: multiplier0( m0 ), multiplier1( m1 ), add0( a0 ), add1( a1 ), qpoly( q ) { }; 
+		typedef P poly_type;
+		typedef f2xt_sequence_base_t< typename f2poly_wider< P >::type > wider_t;
+		
+		f2xt_sequence_base_t( )
+			: qpoly( f2poly_t( 1, 2 ) ), stepcount( 0 ), jump( NULL ) { set_growth( ); };
+		f2xt_sequence_base_t( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q )
+			: multiplier0( m0 ), multiplier1( m1 ), multiplier01( m0 + m1 ), add0( a0 ), add1( a1 ), qpoly( q ), stepcount( 0 ), jump( NULL ) { set_growth( ); }; 
+		
+		// copies keep the word arrays the target already has, moves hand
+		// them over (as in f2t_sequence_base_t)
+		f2xt_sequence_base_t( const f2xt_sequence_base_t &other ) = default;
+		f2xt_sequence_base_t( f2xt_sequence_base_t &&other ) = default;
+		f2xt_sequence_base_t& operator=( const f2xt_sequence_base_t &other ) = default;
+		f2xt_sequence_base_t& operator=( f2xt_sequence_base_t &&other ) = default;
+		
+		// same trajectory and step count, stored in another polynomial type
+		// (the caller has to check that f0 and f1 fit)
+		template< class Q >
+		explicit f2xt_sequence_base_t( const f2xt_sequence_base_t< Q > &other )
+			: f( other.f ),
+			multiplier0( other.multiplier0.poly( ) ), multiplier1( other.multiplier1.poly( ) ),
+			multiplier01( other.multiplier01.poly( ) ),
+			add0( other.add0 ), add1( other.add1 ), qpoly( other.qpoly.poly( ) ),
+			growth( other.growth ), adddeg( other.adddeg ), stepcount( other.stepcount ),
+			jump( f2xt_jump_table_t< P >::get( other.multiplier0.poly( ), other.multiplier1.poly( ),
+				other.add0, other.add1, other.qpoly.poly( ), other.jump_steps( ) ) ) { }
 		
 		// set f0 and f1, either as vectors of words or with l,b
-		void setpolys( std::vector<uint64_t> v0, std::vector<uint64_t> v1 );
+		void setpolys( const std::vector<uint64_t> &v0, const std::vector<uint64_t> &v1 );
 		void setpolys( unsigned int l0, uint64_t b0, unsigned int l1, uint64_t b1 );
 		
 		unsigned int count( ) { return stepcount; }
-		unsigned int degree( );
+		void set_count( unsigned int n ) { stepcount = n; }
+		unsigned int degree( ) const;
 		bool is_zero( );
 		
+		// fingerprint of the pair, f0(alpha) + beta f1(alpha) for a fixed beta
+		// (see f2poly.h), for use as a hash key
+		uint64_t hash( ) const { return f.hash( ); }
+		
+		// words of f0 and f1
+		void wordvectors( std::vector<uint64_t> &a0, std::vector<uint64_t> &a1 ) const { f.wordvectors( a0, a1 ); }
+		
 		void divide( ); // divide by t
 		void step( );	// apply mx+1 map
 		
+		// the highest degree the next step can reach, and whether that still
+		// fits in the polynomial type
+		unsigned int step_degree( ) const
+		{
+			unsigned int d = degree( ) + growth;
+			return d > adddeg ? d : adddeg;
+		}
+		bool fits( ) const { return step_degree( ) <= P::max_degree; }
+		
+		// k steps at once with a jump table (see f2xt_jump_table_t); set_jump
+		// picks the table for k (0 for none), and step_k needs jump_fits( )
+		void set_jump( unsigned int k ) { jump = f2xt_jump_table_t< P >::get( multiplier0.poly( ), multiplier1.poly( ), add0, add1, qpoly.poly( ), k ); }
+		unsigned int jump_steps( ) const { return jump ? jump->k : 0; }
+		bool jump_fits( ) const { return jump && degree( ) + jump->k * growth <= P::max_degree; }
+		void step_k( );
+		
+		// the jump table entry for f, and a lower bound for the degrees of
+		// the terms 1 to k - 1 steps ahead (0 if the table gives none here)
+		const f2xt_jump_entry_t& jump_entry( ) { return jump->lookup( f.bottom0( ), f.bottom1( ) ); }
+		unsigned int jump_low( ) const;
+		
+		// where the sequence has got to (f and the step count), to go back
+		// to after a jump which went too far, or to compare with
+		struct mark_t
+		{
+			f2xt_pair_t< P > f;
+			unsigned int count;
+		};
+		void mark( mark_t &m ) const { m.f = f; m.count = stepcount; }
+		void go_back( const mark_t &m ) { f = m.f; stepcount = m.count; }
+		bool is_at( const mark_t &m ) const { return f == m.f; }		// (whatever the count)
+		
+		// the most one step can raise the degree, and max( deg a0, deg a1 )
+		unsigned int step_growth( ) const { return growth; }
+		unsigned int add_degree( ) const { return adddeg; }
+		
 		// in this setting, "parity" is an element of { 0, 1, x, 1 + x }
-		int parity() { return f0.parity( ) + ( f1.parity( ) << 1 ); }
+		int parity() { return f.parity( ); }
+		
+		// which kernels the products by m0, m1, m0 + m1 and q use
+		void print_kernels( ) const;
 		
 		// display current polynomial
-		void print( );
-		void print_short( );
+		void print( ) const;
+		void print_short( ) const;
 		
 		// print sequences
 		void print_sequence( unsigned int timeout );
 		void print_sequence_degrees( unsigned int timeout, unsigned int gap );
 		void print_parity_sequence( unsigned int timeout );
 		
-		bool operator==( const f2xt_sequence_t &other ) const;
-		bool operator!=( const f2xt_sequence_t &other ) const;
-		
-		~f2xt_sequence_t( ) { };
+		bool operator==( const f2xt_sequence_base_t &other ) const;
+		bool operator!=( const f2xt_sequence_base_t &other ) const;
 };
 
 
+typedef f2xt_sequence_base_t< f2poly_t > f2xt_sequence_t;
+
+
 
 
 
@@ -0,0 +1,457 @@
+#include "f2xt_slices.h"
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+
+// r += a, n words
+static inline __attribute__(( always_inline )) void f2xt_slices_xor( uint64_t * __restrict r, const uint64_t * __restrict a, unsigned int n )
+{
+	for( unsigned int k = 0; k < n; k++ )
+		r[ k ] ^= a[ k ];
+}
+
+
+// Rounds of one step for every lane, until some lane which has a start
+// has to stop: Brent's algorithm would stop there (the hare is 0, or equal
+// to the tortoise, or the timeout is reached), or the next step may not
+// fit. Returns as soon as that happens, with the hare not stepped yet.
+//
+// Everything is done on whole slices, with the choices made by masks, so
+// that the compiler turns each loop into vector instructions of the
+// kernel's width. Each product by a fixed polynomial is built from the
+// hare's slices shifted by its exponents, and only the slices up to the
+// highest degree any lane has got to are gone over.
+template< unsigned int V >
+static inline __attribute__(( always_inline )) void f2xt_slices_rounds_body( f2xt_slices_lanes_t< V > &s, const f2xt_slices_params_t &p )
+{
+	while( 1 )
+	{
+		// the top slice of the hare in use
+		for( ; s.top > 0; s.top-- )
+		{
+			uint64_t any = 0;
+			for( unsigned int v = 0; v < V; v++ )
+				any |= s.h0[ s.top ][ v ] | s.h1[ s.top ][ v ];
+			if( any )
+				break;
+		}
+
+		unsigned int top = s.top > s.ttop ? s.top : s.ttop;
+		uint64_t nonzero[ V ], differ[ V ], high[ V ], stop = 0;
+		for( unsigned int v = 0; v < V; v++ )
+			nonzero[ v ] = differ[ v ] = high[ v ] = 0;
+
+		for( unsigned int k = 0; k <= top; k++ )
+			for( unsigned int v = 0; v < V; v++ )
+			{
+				nonzero[ v ] |= s.h0[ k ][ v ] | s.h1[ k ][ v ];
+				differ[ v ] |= ( s.h0[ k ][ v ] ^ s.t0[ k ][ v ] ) | ( s.h1[ k ][ v ] ^ s.t1[ k ][ v ] );
+			}
+		for( unsigned int k = F2XT_SLICES_DEGREE - p.growth; k <= s.top; k++ )
+			for( unsigned int v = 0; v < V; v++ )
+				high[ v ] |= s.h0[ k ][ v ] | s.h1[ k ][ v ];
+
+		for( unsigned int v = 0; v < V; v++ )
+		{
+			s.zero[ v ] = s.live[ v ] & ~nonzero[ v ];
+			s.equal[ v ] = s.live[ v ] & ~differ[ v ];
+			s.high[ v ] = s.live[ v ] & high[ v ];
+			stop |= s.zero[ v ] | s.equal[ v ] | s.high[ v ];
+		}
+
+		if( stop || s.count >= p.timeout )
+			return;
+
+		// should we advance i to the next power of 2? (the slices of the
+		// hare above its top are 0, so this clears the rest of the tortoise)
+		if( s.i == s.lambda )
+		{
+			memcpy( s.t0, s.h0, ( top + 1 ) * V * sizeof( uint64_t ) );
+			memcpy( s.t1, s.h1, ( top + 1 ) * V * sizeof( uint64_t ) );
+			s.ttop = s.top;
+			s.i <<= 1;
+			s.lambda = 0;
+		}
+
+		// if this is the first term with degree < degree of initial poly,
+		// update sigma: a lane is above its deg0 if it has a 1 in slice
+		// deg0 or higher
+		uint64_t pending = 0;
+		for( unsigned int v = 0; v < V; v++ )
+			pending |= s.nosigma[ v ];
+
+		if( pending )
+		{
+			uint64_t acc[ V ], above[ V ];
+			for( unsigned int v = 0; v < V; v++ )
+				acc[ v ] = above[ v ] = 0;
+
+			for( unsigned int k = s.top; k >= WORDLENGTH; k-- )
+				for( unsigned int v = 0; v < V; v++ )
+					acc[ v ] |= s.h0[ k ][ v ] | s.h1[ k ][ v ];
+			for( unsigned int k = s.top < WORDLENGTH ? s.top : WORDLENGTH - 1; k > 0; k-- )
+				for( unsigned int v = 0; v < V; v++ )
+				{
+					acc[ v ] |= s.h0[ k ][ v ] | s.h1[ k ][ v ];
+					above[ v ] |= acc[ v ] & s.deg0[ k ][ v ];
+				}
+
+			for( unsigned int v = 0; v < V; v++ )
+			{
+				uint64_t below = s.nosigma[ v ] & ~above[ v ];
+				s.nosigma[ v ] &= ~below;
+				for( ; below; below &= below - 1 )
+					s.sigma[ 64 * v + __builtin_ctzll( below ) ] = s.count;
+			}
+		}
+
+		// the step: the products go into x0 and x1, up to the highest
+		// degree they can reach, then the odd lanes take those divided by
+		// t, and the others the hare divided by t
+		unsigned int n = s.top + p.growth > p.adddeg ? s.top + p.growth : p.adddeg;
+		memset( s.x0, 0, ( n + 1 ) * V * sizeof( uint64_t ) );
+		memset( s.x1, 0, ( n + 1 ) * V * sizeof( uint64_t ) );
+
+		for( unsigned int b = 0; b < p.shifts[ 0 ].size( ); b++ )
+			f2xt_slices_xor( s.x0[ p.shifts[ 0 ][ b ] ], s.h0[ 0 ], ( s.top + 1 ) * V );
+		for( unsigned int b = 0; b < p.shifts[ 1 ].size( ); b++ )
+			f2xt_slices_xor( s.x0[ p.shifts[ 1 ][ b ] ], s.h1[ 0 ], ( s.top + 1 ) * V );
+		for( unsigned int b = 0; b < p.shifts[ 2 ].size( ); b++ )
+			f2xt_slices_xor( s.x1[ p.shifts[ 2 ][ b ] ], s.h0[ 0 ], ( s.top + 1 ) * V );
+		for( unsigned int b = 0; b < p.shifts[ 3 ].size( ); b++ )
+			f2xt_slices_xor( s.x1[ p.shifts[ 3 ][ b ] ], s.h1[ 0 ], ( s.top + 1 ) * V );
+
+		for( unsigned int b = 0; b < p.adds[ 0 ].size( ); b++ )
+			for( unsigned int v = 0; v < V; v++ )
+				s.x0[ p.adds[ 0 ][ b ] ][ v ] = ~s.x0[ p.adds[ 0 ][ b ] ][ v ];
+		for( unsigned int b = 0; b < p.adds[ 1 ].size( ); b++ )
+			for( unsigned int v = 0; v < V; v++ )
+				s.x1[ p.adds[ 1 ][ b ] ][ v ] = ~s.x1[ p.adds[ 1 ][ b ] ][ v ];
+
+		uint64_t odd[ V ];
+		for( unsigned int v = 0; v < V; v++ )
+			odd[ v ] = s.h0[ 0 ][ v ] & s.h1[ 0 ][ v ];
+
+		// (slice n of the hare is above its top, so stays 0)
+		for( unsigned int k = 0; k < n; k++ )
+			for( unsigned int v = 0; v < V; v++ )
+			{
+				s.h0[ k ][ v ] = s.h0[ k + 1 ][ v ] ^ ( odd[ v ] & ( s.x0[ k + 1 ][ v ] ^ s.h0[ k + 1 ][ v ] ) );
+				s.h1[ k ][ v ] = s.h1[ k + 1 ][ v ] ^ ( odd[ v ] & ( s.x1[ k + 1 ][ v ] ^ s.h1[ k + 1 ][ v ] ) );
+			}
+
+		s.top = n - 1;
+		s.lambda++;				// period counter
+		s.count++;
+	}
+}
+
+
+static void f2xt_slices_rounds_generic( f2xt_slices_lanes_t< 1 > &s, const f2xt_slices_params_t &p )
+{
+	f2xt_slices_rounds_body< 1 >( s, p );
+}
+
+
+#if defined( __x86_64__ )
+
+__attribute__(( target( "avx2" ) ))
+static void f2xt_slices_rounds_avx2( f2xt_slices_lanes_t< 4 > &s, const f2xt_slices_params_t &p )
+{
+	f2xt_slices_rounds_body< 4 >( s, p );
+}
+
+
+__attribute__(( target( "avx512f" ) ))
+static void f2xt_slices_rounds_avx512( f2xt_slices_lanes_t< 8 > &s, const f2xt_slices_params_t &p )
+{
+	f2xt_slices_rounds_body< 8 >( s, p );
+}
+
+#endif
+
+
+
+// the polynomial in lane j of the slices w, up to slice top, as words
+template< unsigned int V >
+static void f2xt_slices_words( const uint64_t ( *w )[ V ], unsigned int top, unsigned int j, std::vector< uint64_t > &a )
+{
+	a.assign( top / WORDLENGTH + 1, 0 );
+	for( unsigned int k = 0; k <= top; k++ )
+		a[ k / WORDLENGTH ] |= ( w[ k ][ j / 64 ] >> ( j % 64 ) & 1 ) << ( k % WORDLENGTH );
+
+	while( a.size( ) > 1 && !a.back( ) )
+		a.pop_back( );
+}
+
+
+// the term in lane j of the slices w0, w1, as x at step count
+template< unsigned int V, class S >
+static void f2xt_slices_sequence( const uint64_t ( *w0 )[ V ], const uint64_t ( *w1 )[ V ], unsigned int top, unsigned int j, unsigned int count, S &x )
+{
+	std::vector< uint64_t > a0, a1;
+	f2xt_slices_words< V >( w0, top, j, a0 );
+	f2xt_slices_words< V >( w1, top, j, a1 );
+
+	x.setpolys( a0, a1 );
+	x.set_count( count );
+}
+
+
+// put the words a into lane j of the slices w
+template< unsigned int V >
+static void f2xt_slices_put( uint64_t ( *w )[ V ], unsigned int j, const std::vector< uint64_t > &a )
+{
+	for( unsigned int k = 0; k < WORDLENGTH * a.size( ) && k < F2XT_SLICES_DEGREE; k++ )
+		w[ k ][ j / 64 ] |= ( a[ k / WORDLENGTH ] >> ( k % WORDLENGTH ) & 1 ) << ( j % 64 );
+}
+
+
+// the exponents of the terms of a
+static void f2xt_slices_exponents( const f2poly_t &a, std::vector< unsigned int > &e )
+{
+	e.clear( );
+	for( unsigned int k = 0; k <= a.degree; k++ )
+		if( a.checkbit( k ) )
+			e.push_back( k );
+}
+
+
+
+f2xt_slices_t::f2xt_slices_t( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k, const char *want )
+	: proto( m0, m1, a0, a1, q ), finished( 0 ), handed( 0 )
+{
+	proto.set_jump( k );
+	
+	// the four fixed factors of the step: f0 gets f0 m0 + f1 m1 q and f1
+	// gets f0 m1 + f1( m0 + t m1 )
+	f2poly_t m1q = m1, m01t = m1;
+	m1q *= q;
+	m01t *= f2poly_t( 1, 2 );
+	m01t += m0;
+
+	f2xt_slices_exponents( m0, params.shifts[ 0 ] );
+	f2xt_slices_exponents( m1q, params.shifts[ 1 ] );
+	f2xt_slices_exponents( m1, params.shifts[ 2 ] );
+	f2xt_slices_exponents( m01t, params.shifts[ 3 ] );
+	f2xt_slices_exponents( a0, params.adds[ 0 ] );
+	f2xt_slices_exponents( a1, params.adds[ 1 ] );
+
+	params.growth = proto.step_growth( );
+	params.adddeg = proto.add_degree( );
+	params.timeout = 0;
+
+	width = 1;
+	name = "generic";
+
+#if defined( __x86_64__ )
+	__builtin_cpu_init( );
+	bool has_avx2 = __builtin_cpu_supports( "avx2" );
+	bool has_avx512 = __builtin_cpu_supports( "avx512f" );
+
+	if( want != NULL && !strcmp( want, "generic" ) )
+		has_avx2 = has_avx512 = false;
+	else if( want != NULL && !strcmp( want, "avx2" ) )
+		has_avx512 = false;
+
+	if( has_avx512 )
+	{
+		width = 8;
+		name = "avx512";
+	}
+	else if( has_avx2 )
+	{
+		width = 4;
+		name = "avx2";
+	}
+#else
+	(void) want;
+#endif
+}
+
+
+void f2xt_slices_t::run( const std::vector< std::pair< uint64_t, uint64_t > > &starts, unsigned int timeout, bool save, std::vector< f2xt_slices_result_t > &results, std::vector< std::pair< unsigned int, f2xt_brent_state_t > > &states )
+{
+#if defined( __x86_64__ )
+	if( width == 8 )
+		run_as< 8 >( starts, timeout, save, results, states, f2xt_slices_rounds_avx512 );
+	else if( width == 4 )
+		run_as< 4 >( starts, timeout, save, results, states, f2xt_slices_rounds_avx2 );
+	else
+#endif
+		run_as< 1 >( starts, timeout, save, results, states, f2xt_slices_rounds_generic );
+}
+
+
+template< unsigned int V >
+void f2xt_slices_t::run_as( const std::vector< std::pair< uint64_t, uint64_t > > &starts, unsigned int timeout, bool save, std::vector< f2xt_slices_result_t > &results, std::vector< std::pair< unsigned int, f2xt_brent_state_t > > &states, void ( *rounds )( f2xt_slices_lanes_t< V > &, const f2xt_slices_params_t & ) )
+{
+	// the terms in the lanes fit in this
+	typedef f2xt_sequence_base_t< f2poly_fixed< F2XT_SLICES_DEGREE / WORDLENGTH > > S;
+
+	results.resize( starts.size( ) );
+	params.timeout = timeout;
+
+	f2xt_slices_lanes_t< V > s;
+	unsigned int index[ 64 * V ];		// of the start in each lane
+	unsigned int deg0[ 64 * V ];
+	unsigned int next = 0;
+
+	S x( proto ), y( proto );
+	std::vector< uint64_t > a0, a1;
+
+	while( next < starts.size( ) )
+	{
+		// fill the lanes with the next starts which fit, with the hare one
+		// step ahead, as at the beginning of Brent's algorithm
+		memset( &s, 0, sizeof( s ) );
+		unsigned int filled = 0;
+
+		while( filled < 64 * V && next < starts.size( ) )
+		{
+			unsigned int k = next++;
+			x.setpolys( 1, starts[ k ].first, 1, starts[ k ].second );
+			if( !x.fits( ) )
+			{
+				results[ k ].status = SLICES_SKIPPED;
+				continue;
+			}
+
+			unsigned int j = filled++;
+			uint64_t bit = uint64_t( 1 ) << ( j % 64 );
+
+			x.wordvectors( a0, a1 );
+			f2xt_slices_put< V >( s.t0, j, a0 );
+			f2xt_slices_put< V >( s.t1, j, a1 );
+
+			deg0[ j ] = x.degree( );
+			if( deg0[ j ] )
+			{
+				s.deg0[ deg0[ j ] ][ j / 64 ] |= bit;
+				s.nosigma[ j / 64 ] |= bit;
+			}
+
+			x.step( );
+			x.wordvectors( a0, a1 );
+			f2xt_slices_put< V >( s.h0, j, a0 );
+			f2xt_slices_put< V >( s.h1, j, a1 );
+
+			s.live[ j / 64 ] |= bit;
+			index[ j ] = k;
+		}
+
+		s.count = 1;
+		s.i = 1;
+		s.lambda = 1;
+		s.top = F2XT_SLICES_DEGREE - 1;
+		s.ttop = WORDLENGTH - 1;
+
+		unsigned int left = filled;
+		while( left )
+		{
+			rounds( s, params );
+
+			// deal with the lanes which stopped, in the order Brent's
+			// algorithm looks at why it stopped; once most of the lanes
+			// have, the rest are handed back as well
+			bool over = s.count >= timeout;
+			bool stragglers = false;
+
+			for( unsigned int pass = 0; pass < 2; pass++ )
+			{
+				for( unsigned int j = 0; j < filled; j++ )
+				{
+					uint64_t bit = uint64_t( 1 ) << ( j % 64 );
+					unsigned int v = j / 64;
+
+					if( !( s.live[ v ] & bit ) )
+						continue;
+					if( !stragglers && !over && !( ( s.zero[ v ] | s.equal[ v ] | s.high[ v ] ) & bit ) )
+						continue;
+
+					f2xt_slices_result_t &r = results[ index[ j ] ];
+					r.d = 0;
+					r.mu = 0;
+					r.lambda = 0;
+					r.sigma = s.sigma[ j ];
+
+					if( s.zero[ v ] & bit )
+					{
+						// return mu = time to 0, lambda = 0
+						r.status = SLICES_DONE;
+						r.mu = s.count;
+					}
+					else if( over )
+					{
+						r.status = SLICES_TIMEOUT;
+						f2xt_slices_sequence< V >( s.h0, s.h1, s.top, j, s.count, x );
+						r.d = x.degree( ) ? x.degree( ) : 1;
+					}
+					else if( s.equal[ v ] & bit )
+					{
+						// lambda is the period; go over the trajectory again
+						// with the hare lambda steps ahead to find mu
+						r.status = SLICES_DONE;
+						r.lambda = s.lambda;
+
+						x.setpolys( 1, starts[ index[ j ] ].first, 1, starts[ index[ j ] ].second );
+						y = x;
+						for( unsigned int k = 0; k < r.lambda; k++ )
+							y.step( );
+						while( x != y )
+						{
+							x.step( );
+							y.step( );
+						}
+						r.mu = x.count( );
+					}
+					else
+						r.status = SLICES_RESUME;
+
+					if( r.status == SLICES_RESUME || ( r.status == SLICES_TIMEOUT && save ) )
+					{
+						states.push_back( std::make_pair( index[ j ], f2xt_brent_state_t( ) ) );
+						f2xt_brent_state_t &state = states.back( ).second;
+
+						state.f = proto;
+						state.f.setpolys( 1, starts[ index[ j ] ].first, 1, starts[ index[ j ] ].second );
+						state.tortoise = proto;
+						f2xt_slices_sequence< V >( s.t0, s.t1, s.ttop, j, s.count - s.lambda, state.tortoise );
+						state.hare = proto;
+						f2xt_slices_sequence< V >( s.h0, s.h1, s.top, j, s.count, state.hare );
+						state.i = s.i;
+						state.deg0 = deg0[ j ];
+						state.lambda = s.lambda;
+						state.sigma = s.sigma[ j ];
+						state.maxdegree = S::poly_type::max_degree;
+					}
+
+					if( r.status == SLICES_RESUME )
+						handed++;
+					else
+						finished++;
+
+					// take the lane out of the slices
+					unsigned int top = s.top > s.ttop ? s.top : s.ttop;
+					for( unsigned int k = 0; k <= top; k++ )
+					{
+						s.t0[ k ][ v ] &= ~bit;
+						s.t1[ k ][ v ] &= ~bit;
+						s.h0[ k ][ v ] &= ~bit;
+						s.h1[ k ][ v ] &= ~bit;
+					}
+					s.live[ v ] &= ~bit;
+					s.nosigma[ v ] &= ~bit;
+					left--;
+				}
+
+				if( left && left * F2XT_SLICES_STRAGGLERS >= filled )
+					break;
+				stragglers = true;
+			}
+		}
+	}
+}
@@ -0,0 +1,138 @@
+/* f2xt_slices_t
+ *
+ * Brent's algorithm on many small f2xt trajectories at once, bit-sliced:
+ * the coefficients of f0 and f1 are stored by degree, bit j of slice k
+ * being the coefficient of t^k in lane j, so that a slice is one word for
+ * 64 lanes (or 4 or 8 words, for 256 or 512 lanes, with AVX2 or AVX-512).
+ * m, q and a are the same in every lane, so with f = f0 + xf1 the step
+ *     f0' = ( f0 m0 + f1 m1 q + a0 )/t
+ *     f1' = ( f0 m1 + f1( m0 + t m1 ) + a1 )/t
+ * is a fixed sequence of xors of whole slices, one for each term of the
+ * four products, and the lanes which are odd (f0 and f1 both odd) take it
+ * while the others are only divided by t, picked by a mask.
+ *
+ * The lanes are filled together and run in lockstep, so the powers of 2
+ * and the moves of the tortoise in Brent's algorithm are the same for all
+ * of them; what is per lane (reaching 0, meeting the tortoise, sigma) is
+ * found with masks. A lane which stops is dealt with on its own, and mu
+ * is found by going over the trajectory again from the start (as in
+ * f2t_batch_t). Lanes which would outgrow the slices, and those still
+ * going once most of the others have stopped, are handed back with where
+ * Brent's algorithm had got to, to be carried on by f2xt_resume. None of
+ * the other tricks of the cycle search (distinguished points, the
+ * catalogue) are used in the lanes. The outcome is the same either way.
+ *
+ */
+
+
+#ifndef F2XT_SLICES_H
+#define F2XT_SLICES_H
+
+#include "f2xt_findcycles.h"
+#include "f2xt_sequence.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// number of slices: the lanes hold terms of degree < F2XT_SLICES_DEGREE
+#define F2XT_SLICES_DEGREE 128
+
+// most words in a slice
+#define F2XT_SLICES_WIDTH_MAX 8
+
+// the lanes still going are handed back once fewer than 1 in this many are
+#define F2XT_SLICES_STRAGGLERS 8
+
+
+enum f2xt_slices_status_t
+{
+	SLICES_DONE,		// mu, lambda and sigma are known
+	SLICES_TIMEOUT,		// d is the degree where it timed out
+	SLICES_RESUME,		// handed back; carry on with f2xt_resume
+	SLICES_SKIPPED		// too big for the lanes to begin with
+};
+
+struct f2xt_slices_result_t
+{
+	f2xt_slices_status_t status;
+	unsigned int d, mu, lambda, sigma;
+};
+
+
+// the slices of all the lanes, V words each: coefficient k of lane j is
+// bit j % 64 of [ k ][ j / 64 ]
+template< unsigned int V >
+struct f2xt_slices_lanes_t
+{
+	alignas( 64 ) uint64_t t0[ F2XT_SLICES_DEGREE ][ V ];	// tortoise
+	alignas( 64 ) uint64_t t1[ F2XT_SLICES_DEGREE ][ V ];
+	alignas( 64 ) uint64_t h0[ F2XT_SLICES_DEGREE ][ V ];	// hare
+	alignas( 64 ) uint64_t h1[ F2XT_SLICES_DEGREE ][ V ];
+	alignas( 64 ) uint64_t x0[ F2XT_SLICES_DEGREE ][ V ];	// products, for the step
+	alignas( 64 ) uint64_t x1[ F2XT_SLICES_DEGREE ][ V ];
+	alignas( 64 ) uint64_t deg0[ WORDLENGTH ][ V ];		// the lanes starting at each degree > 0
+
+	uint64_t live[ V ];			// the lanes with a start
+	uint64_t nosigma[ V ];		// and no sigma yet (nor deg0 = 0)
+	uint64_t zero[ V ], equal[ V ], high[ V ];	// why the rounds stopped
+
+	unsigned int count, i, lambda;		// of the hare, shared by the lanes
+	unsigned int top, ttop;				// no slices above these are used
+	unsigned int sigma[ 64 * V ];
+};
+
+// what the rounds need to know about the map and the timeout
+struct f2xt_slices_params_t
+{
+	std::vector< unsigned int > shifts[ 4 ];	// exponents of m0, m1 q, m1, m0 + t m1
+	std::vector< unsigned int > adds[ 2 ];		// and of a0, a1
+	unsigned int growth, adddeg;
+	unsigned int timeout;
+};
+
+
+class f2xt_slices_t
+{
+	private:
+		f2xt_sequence_t proto;		// the map, and the jumps, for the states handed back
+		f2xt_slices_params_t params;
+
+		unsigned int width;			// words in a slice
+		const char *name;
+
+		template< unsigned int V >
+		void run_as( const std::vector< std::pair< uint64_t, uint64_t > > &starts, unsigned int timeout, bool save, std::vector< f2xt_slices_result_t > &results, std::vector< std::pair< unsigned int, f2xt_brent_state_t > > &states, void ( *rounds )( f2xt_slices_lanes_t< V > &, const f2xt_slices_params_t & ) );
+
+	public:
+		unsigned int finished;		// trajectories done in the lanes
+		unsigned int handed;		// and handed back
+
+		// for the map with m = m0 + xm1, a = a0 + xa1 and q (the states
+		// handed back use k-step jumps). want is "generic", "avx2" or
+		// "avx512" to pick a kernel (if the CPU has it), or NULL for the
+		// best one
+		f2xt_slices_t( const f2poly_t &m0, const f2poly_t &m1, const f2poly_t &a0, const f2poly_t &a1, const f2poly_t &q, unsigned int k, const char *want );
+
+		// whether the lanes can take one word starts for this map
+		static bool supported( const f2xt_sequence_t &f )
+		{
+			return f.step_growth( ) + WORDLENGTH <= F2XT_SLICES_DEGREE && f.add_degree( ) < F2XT_SLICES_DEGREE;
+		}
+
+		const char *kernel_name( ) const { return name; }
+		unsigned int lane_count( ) const { return 64 * width; }
+
+		// Run Brent's algorithm up to timeout on the trajectories from
+		// b0 + xb1 for each ( b0, b1 ) in starts, as f2xt_findperiod
+		// would, with the outcome in results[ k ]. Those handed back, and
+		// those which time out if save is set, are listed in states with
+		// where they got to (see f2xt_resume); the skipped ones are left to
+		// the caller.
+		void run( const std::vector< std::pair< uint64_t, uint64_t > > &starts, unsigned int timeout, bool save, std::vector< f2xt_slices_result_t > &results, std::vector< std::pair< unsigned int, f2xt_brent_state_t > > &states );
+};
+
+
+
+
+#endif